@@ -73,7 +73,11 @@ void setup()
 {
     Serial.begin(c_uiMonitorBaud);
 
-    matrix.init();  /** Initialize the ButtonMatrix */
+    if (!matrix.init())  /** Initialize the ButtonMatrix */
+    {
+        Serial.println("Error: ButtonMatrix init failed.");
+        while (1);
+    }
     //matrix.setInvertInput(); /** Uncomment if you get a pressed signal while button is released and vice versa */
 }
 
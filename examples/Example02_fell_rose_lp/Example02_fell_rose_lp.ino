@@ -75,7 +75,11 @@ void setup()
 {
     Serial.begin(c_uiMonitorBaud);
 
-    matrix.init();  /** Initialize the ButtonMatrix*/
+    if (!matrix.init())  /** Initialize the ButtonMatrix*/
+    {
+        Serial.println("Error: ButtonMatrix init failed.");
+        while (1);
+    }
     //matrix.setInvertInput(); /** Uncomment if you get a pressed signal while button is released and vice versa */
 }
 
@@ -95,8 +99,9 @@ void loop()
     {
         // There was a change in any of the buttons
 
-        // Scan all buttons, except the last one
-        for (uint16_t idx = 0; idx < numButtons; idx++)
+        // Just visit the buttons that have changed during this update
+        const KeySet& changed = matrix.getChangedKeys();
+        for (uint16_t idx = changed.findFirst(); KeySet::npos != idx; idx = changed.findNext(idx))
         {
             pButton = matrix.getButton(idx);
             if (pButton->fell())
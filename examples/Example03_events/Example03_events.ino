@@ -107,6 +107,11 @@ void event_Button_Action(Button& button)
             Serial.print("Button long pressed "); Serial.println(button.getNumber());
             break;
 
+        case BTN_ACTION_REPEAT:
+            // Button is held (only if enabled by setAutoRepeat())
+            Serial.print("Button repeated "); Serial.println(button.getNumber());
+            break;
+
         default:
             Serial.print("Ooops ... strange event for button "); Serial.println(button.getNumber());
             break;
@@ -119,7 +124,11 @@ void setup()
 {
     Serial.begin(c_uiMonitorBaud);
 
-    matrix.init();  // Initialize the ButtonMatrix
+    if (!matrix.init())  // Initialize the ButtonMatrix
+    {
+        Serial.println("Error: ButtonMatrix init failed.");
+        while (1);
+    }
     //matrix.setInvertInput(); /** Uncomment if you get a pressed signal while button is released and vice versa */
     matrix.setMinLongPressDuration(longPressDuration); // Set the long press duration in ms
 
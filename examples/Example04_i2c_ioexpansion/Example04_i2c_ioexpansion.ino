@@ -106,7 +106,13 @@ void setup()
         while (1);
     }
 
-    matrix.init();  /** Initialize the ButtonMatrix*/
+    //matrix.setDriveMode(DRIVE_PUSH_PULL); /** Uncomment if your matrix has diodes (saves the I2C pin mode transfers during the scan) */
+    if (!matrix.init())  /** Initialize the ButtonMatrix*/
+    {
+        Serial.println("Error: ButtonMatrix init failed.");
+        while (1);
+    }
+    //matrix.calibrateSettleTime(0); /** Uncomment if you get ghost keys on long cables (hold button 0 and no other during setup) */
     //matrix.setInvertInput(); /** Uncomment if you get a pressed signal while button is released and vice versa */
 }
 
@@ -87,8 +87,11 @@ const uint8_t ROWS = 3; /** Number of button matrix rows */
 //       Pin number mapping for each board:
 //          0 ..  7: GPA0 .. GPA7
 //          8 .. 15: GPB0 .. GPB7
-uint8_t colPins[COLS] = {100,101,102}; /** Button matrix column pins (0-2 on second mcp) */
-uint8_t rowPins[ROWS] = {000,001,002}; /** Button matrix row pins    (0-2 on first mcp) */
+//       Virtual pins above 255 (more than two boards) require the build flag BTNMATRIX_WIDE_PINS.
+//       Alternatively pass a pin range of 16 as third template parameter of the MultiMCPHandler
+//       to address up to eight boards with 8 bit pins (board 1: 0-15, board 2: 16-31, ...)
+pin_t colPins[COLS] = {100,101,102}; /** Button matrix column pins (0-2 on second mcp) */
+pin_t rowPins[ROWS] = {000,001,002}; /** Button matrix row pins    (0-2 on first mcp) */
 
 
 /** Button matrix button definitons */
@@ -99,6 +102,11 @@ Button buttons[ROWS][COLS] = {
 };
 
 // Note that we have to tell the ButtonMatrix to use the i2c io handler now (last c'tor param)
+// If you want to avoid any heap usage (build flag BTNMATRIX_NO_HEAP), declare the handlers as objects instead:
+//   AdafruitI2CIOHandler<Adafruit_MCP23X17> io0(mcp[0]), io1(mcp[1]);
+//   IOHandlerItf* handlers[numMCPs] = { &io0, &io1 };
+//   MultiMCPHandler<AdafruitI2CIOHandler<Adafruit_MCP23X17>, Adafruit_MCP23X17> multiIO(handlers, numMCPs);
+//   ButtonMatrix matrix((Button*)buttons, rowPins, colPins, ROWS, COLS, multiIO);
 ButtonMatrix matrix(
                 (Button*)buttons, rowPins, colPins, ROWS, COLS,
                 MultiMCPHandler<AdafruitI2CIOHandler<Adafruit_MCP23X17>, Adafruit_MCP23X17>::getInstance(mcp, numMCPs));
@@ -118,7 +126,11 @@ void setup()
         }
     }
 
-    matrix.init();  /** Initialize the ButtonMatrix*/
+    if (!matrix.init())  /** Initialize the ButtonMatrix*/
+    {
+        Serial.println("Error: ButtonMatrix init failed.");
+        while (1);
+    }
     //matrix.setInvertInput(); /** Uncomment if you get a pressed signal while button is released and vice versa */
 }
 
@@ -31,17 +31,24 @@
 
 namespace RSys
 {
+#ifndef BTNMATRIX_NO_HEAP
     /**
         @brief  Helper to create an io handler instance
         @param  mcp
                 Concrete I2C implementation object earlier instantiated
     */
     #define ADFI2C(mcp) AdafruitI2CIOHandler<decltype(mcp)>::getInstance(mcp)
+#endif
 
 
 
     /**
-        @brief  Handles I2C IO by means of the Adafruit MCP23017 Arduino library implementation
+        @brief  Handles I2C IO by means of the Adafruit MCP23017 Arduino library implementation.
+                The library can't read the output latches (OLAT), so each write of both ports reads
+                them first and the pins not written by the handler take over their current level
+                (outputs keep their state, the latches of inputs don't matter). If the MCP is
+                exclusive to the matrix, setExclusive() caches the written latches instead,
+                so a drive line costs one write and one read transaction
         @tparam I2CImpl
                 I2C handler implementation
         @implements IOHandlerItf
@@ -51,23 +58,99 @@ namespace RSys
     {
     public:
 
-        virtual void pinMode(uint8_t pin, uint8_t mode)
+        virtual void pinMode(pin_t pin, uint8_t mode)
         {
             m_i2cImpl.pinMode(pin, mode);
         }
 
-        virtual void digitalWrite(uint8_t pin, uint8_t val)
+        /** @brief Writes the cached output latch with a single I2C transaction once it is known (see IOHandlerItf) */
+        virtual void digitalWrite(pin_t pin, uint8_t val)
         {
-            m_i2cImpl.digitalWrite(pin, val);
+            if (m_exclusive && m_latchValid && pin < 16)
+            {
+                setLatch(pin, val);
+                m_i2cImpl.writeGPIOAB(m_latch);
+            }
+            else
+            {
+                m_i2cImpl.digitalWrite(pin, val);
+            }
         }
 
-        virtual int digitalRead(uint8_t pin)
+        virtual int digitalRead(pin_t pin)
         {
             return m_i2cImpl.digitalRead(pin);
         }
 
+        /**
+            @brief  Writes both ports of the MCP23017 with a single read and write transaction (see IOHandlerItf).
+                    The output latches of the other pins take over their current level
+        */
+        virtual void digitalWriteMulti(const pin_t* pins, uint8_t numPins, uint8_t val)
+        {
+            readLatch();
+            for (uint8_t idx = 0; idx < numPins; idx++)
+            {
+                if (pins[idx] < 16)
+                {
+                    setLatch(pins[idx], val);
+                }
+            }
+            m_i2cImpl.writeGPIOAB(m_latch);
+        }
+
+        /** @brief Reads both ports of the MCP23017 in a single I2C transaction (see IOHandlerItf) */
+        virtual void digitalReadMulti(const pin_t* pins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+        {
+            (void)mask;
+            unpack(m_i2cImpl.readGPIOAB(), pins, numPins, bits);
+        }
+
+        /**
+            @brief  Writes the output latch and reads both ports afterwards (see IOHandlerItf).
+                    A drive line costs one write and one read transaction if the MCP is exclusive
+                    to the matrix, the latch is read before otherwise
+        */
+        virtual void driveAndRead(pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                                  const pin_t* pins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+        {
+            if (drivePin >= 16)
+            {
+                IOHandlerItf::driveAndRead(drivePin, driveVal, settleUs, pins, numPins, mask, bits);
+                return;
+            }
+
+            readLatch();
+            setLatch(drivePin, driveVal);
+            m_i2cImpl.writeGPIOAB(m_latch);
+            if (0 < settleUs)
+            {
+                delayMicroseconds(settleUs);
+            }
+            if (0 < numPins)
+            {
+                unpack(m_i2cImpl.readGPIOAB(), pins, numPins, bits);
+            }
+        }
+
+       /**
+            @brief  c'tor
+                    (declare the handler as static object to avoid any heap usage)
+            @param  i2cImpl
+                    Reference to the MCP implementation
+        */
+        explicit AdafruitI2CIOHandler(I2CImpl& i2cImpl)
+        :   m_i2cImpl(i2cImpl),
+            m_latch(0),
+            m_latchValid(false),
+            m_exclusive(false)
+        {
+        }
+
+#ifndef BTNMATRIX_NO_HEAP
        /**
             @brief  Returns the implementation for an Adafruit I2C handler
+                    (allocated on the heap and never freed)
             @param  i2cImpl
                     Reference to the MCP implementation
             @return Reference to the implementation
@@ -76,21 +159,88 @@ namespace RSys
         {
             return *(new AdafruitI2CIOHandler(i2cImpl));
         }
+#endif
+
+        /**
+            @brief  Drops the cached output latch, so it is read from the MCP again
+                    (called by ButtonMatrix::reinit(), call it after the outputs have been written
+                    bypassing the handler, see IOHandlerItf)
+        */
+        virtual void invalidate() { m_latchValid = false; }
+
+        /**
+            @brief  Declares the MCP exclusive to the matrix, so the output latch is cached
+                    instead of being read before each write. Nothing else may write the outputs
+                    of the MCP then (call invalidate() if it does nevertheless)
+            @param  bExclusive
+                    True if the MCP is exclusive to the matrix
+        */
+        inline void setExclusive(bool bExclusive)
+        {
+            m_exclusive = bExclusive;
+            m_latchValid = false;
+        }
 
     private:
 
-       /**
-            @brief  c'tor
-            @param  i2cImpl
-                    Reference to the MCP implementation
-            @return Reference to the implementation
+        /**
+            @brief  Reads the output latch from the MCP unless it is cached
+                    (the levels of the pins are taken, as the library can't read OLAT)
         */
-        AdafruitI2CIOHandler(I2CImpl& i2cImpl)
-        :   m_i2cImpl(i2cImpl)
+        inline void readLatch()
         {
+            if (!m_exclusive || !m_latchValid)
+            {
+                m_latch = m_i2cImpl.readGPIOAB();
+                m_latchValid = true;
+            }
         }
 
-        I2CImpl& m_i2cImpl; /** Reference to the Adafruit I2C implementation */
+        /**
+            @brief  Sets a pin within the cached output latch
+            @param  pin
+                    Pin number (0...15)
+            @param  val
+                    State value
+        */
+        inline void setLatch(pin_t pin, uint8_t val)
+        {
+            const uint16_t bit = 1u << pin;
+            m_latch = (LOW == val) ? (m_latch & ~bit) : (m_latch | bit);
+        }
+
+        /**
+            @brief  Unpacks the port states of the pins requested
+            @param  gpio
+                    States of both ports (port B in the upper byte)
+            @param  pins
+                    Array of pin numbers
+            @param  numPins
+                    Number of pins in the array
+            @param  bits
+                    Packed bits (LSB first) receiving the pin states
+        */
+        static void unpack(uint16_t gpio, const pin_t* pins, uint8_t numPins, uint8_t* bits)
+        {
+            for (uint8_t idx = 0; idx < numPins; idx++)
+            {
+                const uint8_t bit = 1 << (idx & 7);
+                if (0 == (idx & 7))
+                {
+                    bits[idx >> 3] = 0;
+                }
+                if (pins[idx] < 16 && (gpio & (1u << pins[idx])))
+                {
+                    bits[idx >> 3] |= bit;
+                }
+            }
+        }
+
+
+        I2CImpl&    m_i2cImpl;      /** Reference to the Adafruit I2C implementation */
+        uint16_t    m_latch;        /** Cached output latch of both ports */
+        bool        m_latchValid;   /** Output latch has been read or written by the handler */
+        bool        m_exclusive;    /** MCP is exclusive to the matrix, the output latch is cached */
 
     };
 
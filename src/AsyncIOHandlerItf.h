@@ -0,0 +1,90 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         AsyncIOHandlerItf.h
+  -----------------------------------------------------------------------------
+  @brief        Interface to non-blocking IO handlers (i.e. interrupt or DMA
+                driven I2C/SPI transfers)
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef AsyncIOHandlerItf_h
+#define AsyncIOHandlerItf_h
+
+#include <Arduino.h>
+#include "IOHandlerItf.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Abstract interface to IO handlers able to perform the transfers of the scan
+               without blocking. Only one transfer is pending at a time, the matrix starts it
+               and polls for its completion on each update().
+               The blocking operations of IOHandlerItf are still used for the pin configuration
+               (and for the pin modes during the scan unless DRIVE_PUSH_PULL is set)
+        @implements IOHandlerItf
+    */
+    class AsyncIOHandlerItf : public IOHandlerItf
+    {
+    public:
+
+        /**
+            @brief  Starts setting an output pin and reading several pins afterwards
+                    (see IOHandlerItf::driveAndRead())
+            @param  drivePin
+                    Output pin number
+            @param  driveVal
+                    State value of the output pin
+            @param  settleUs
+                    Time in microseconds to wait between driving and reading (0 for none)
+            @param  pins
+                    Array of pin numbers to be read (valid until the transfer has completed)
+            @param  numPins
+                    Number of pins in the array
+            @param  mask
+                    Packed bits (LSB first) selecting the pins to be read, NULL to read all pins
+                    (copy it if needed after the call)
+            @return False if the transfer could not be started (i.e. the bus is busy)
+        */
+        virtual bool startDriveAndRead(pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                                       const pin_t* pins, uint8_t numPins, const uint8_t* mask) = 0;
+
+        /**
+            @brief  Starts setting an output pin to a particular state
+            @param  pin
+                    Pin number
+            @param  val
+                    State value
+            @return False if the transfer could not be started (i.e. the bus is busy)
+        */
+        virtual bool startDigitalWrite(pin_t pin, uint8_t val) = 0;
+
+        /**
+            @brief  Checks whether the pending transfer has completed
+            @param  bits
+                    Packed bits (LSB first) receiving the pin states of a completed read (set for HIGH)
+            @return True if the transfer has completed (or no transfer is pending)
+        */
+        virtual bool poll(uint8_t* bits) = 0;
+
+        virtual AsyncIOHandlerItf* asAsync() { return this; }
+    };
+}
+
+
+#endif // AsyncIOHandlerItf_h
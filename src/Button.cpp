@@ -31,15 +31,18 @@ namespace RSys
     // Button
     // ------
 
-    Button::Button(uint8_t number, bool bEnabled)
+    Button::Button(btn_num_t number, bool bEnabled)
     //-----------------------------------------------------------------------------
     :   m_buttonNo(number),
         m_curState(BTN_STATE_RELEASED),
         m_prevState(BTN_STATE_UNINITIALIZED),
         m_lastAction(BTN_ACTION_NONE),
         m_bEnabled(bEnabled),
-        m_stateChangeMillis(millis()),
+        m_stateChangeMillis(0),
         m_prevStateDuration(0),
+#if BTNMATRIX_EVENT_MICROS
+        m_stateChangeMicros(0),
+#endif
         m_swallowNextRoseEvent(false),
         m_stateChanged(false),
         m_fell(false),
@@ -51,7 +54,7 @@ namespace RSys
 
 
 
-    uint8_t Button::getNumber() const
+    btn_num_t Button::getNumber() const
     //-----------------------------------------------------------------------------
     {
         return m_buttonNo;
@@ -99,12 +102,39 @@ namespace RSys
 
 
 
+    void Button::startInitialState(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        if (BTN_STATE_UNINITIALIZED == m_prevState)
+        {
+            m_stateChangeMillis = now;
+        }
+    }
+
+
+
     bool Button::isLongPressed(uint16_t ms) const
     //-----------------------------------------------------------------------------
+    {
+        return isLongPressed(ms, NativeClock::getDefault().millis());
+    }
+
+
+
+    bool Button::isLongPressed(uint16_t ms, ClockItf& clock) const
+    //-----------------------------------------------------------------------------
+    {
+        return isLongPressed(ms, clock.millis());
+    }
+
+
+
+    bool Button::isLongPressed(uint16_t ms, unsigned long now) const
+    //-----------------------------------------------------------------------------
     {
         bool long_press = false;
 
-        if (!m_longPress && isPressed() && getCurStateDuration() >= ms)
+        if (!m_longPress && isPressed() && getCurStateDuration(now) >= ms)
         {
             long_press = true;
             m_longPress = true;
@@ -118,7 +148,23 @@ namespace RSys
     unsigned long Button::getCurStateDuration() const
     //-----------------------------------------------------------------------------
     {
-        return millis() - m_stateChangeMillis;
+        return getCurStateDuration(NativeClock::getDefault().millis());
+    }
+
+
+
+    unsigned long Button::getCurStateDuration(ClockItf& clock) const
+    //-----------------------------------------------------------------------------
+    {
+        return getCurStateDuration(clock.millis());
+    }
+
+
+
+    unsigned long Button::getCurStateDuration(unsigned long now) const
+    //-----------------------------------------------------------------------------
+    {
+        return now - m_stateChangeMillis;
     }
 
 
@@ -137,15 +183,15 @@ namespace RSys
     }
 
 
-    bool Button::updateState(const BTN_STATE newState)
+    bool Button::updateState(const BTN_STATE newState, const unsigned long now)
     //-----------------------------------------------------------------------------
     {
         // we just update if the new state differs from the current one
         if (newState != m_curState)
         {
             m_rose = m_fell = false;
-            m_prevStateDuration = getCurStateDuration();
-            m_stateChangeMillis = millis();
+            m_prevStateDuration = getCurStateDuration(now);
+            m_stateChangeMillis = now;
 
             m_prevState = m_curState;
             m_curState = newState;
@@ -26,6 +26,8 @@
 
 #include <Arduino.h>
 #include "ButtonBaseItf.h"
+#include "ButtonMatrixConfig.h"
+#include "NativeClock.h"
 
 
 namespace RSys
@@ -48,7 +50,7 @@ namespace RSys
                     False, if the button shall be disabled by default
                     A disabled button does not notify anything and always reports RELEASED state!
         */
-        Button(uint8_t number, bool bEnabled = true);
+        Button(btn_num_t number, bool bEnabled = true);
 
         /**
             @brief  d'tor
@@ -59,7 +61,7 @@ namespace RSys
             @brief  Gets the buttons number
             @return The buttons number
         */
-        uint8_t getNumber() const;
+        btn_num_t getNumber() const;
 
         /**
             @brief  Determines whether or not the button is enabled
@@ -93,26 +95,85 @@ namespace RSys
         */
         bool isPressed() const;
 
+        /**
+            @brief  Starts the duration of the initial state (called by ButtonMatrix::init(),
+                    ignored once the state has changed)
+            @param  now
+                    Current timestamp in ms
+        */
+        void startInitialState(unsigned long now);
+
         /**
             @brief  Determines whether or not the button is pressed longer
             @param  ms
                     Time period in ms after which a press duration is seen as a long press
-            @return True, if the button is long pressed
+            @return True, if the button is long pressed (at the time of the native clock)
         */
         bool isLongPressed(uint16_t ms) const;
 
+        /**
+            @brief  Determines whether or not the button is pressed longer
+            @param  ms
+                    Time period in ms after which a press duration is seen as a long press
+            @param  clock
+                    Time source (i.e. the clock of the matrix, see ButtonMatrix::getClock())
+            @return True, if the button is long pressed
+        */
+        bool isLongPressed(uint16_t ms, ClockItf& clock) const;
+
+        /**
+            @brief  Determines whether or not the button is pressed longer
+            @param  ms
+                    Time period in ms after which a press duration is seen as a long press
+            @param  now
+                    Current timestamp in ms
+            @return True, if the button is long pressed
+        */
+        bool isLongPressed(uint16_t ms, unsigned long now) const;
+
         /**
             @brief  Determines the duration the button is in the current state
-            @return The duration in ms (roll over after ~50 days!)
+            @return The duration in ms until the time of the native clock (roll over after ~50 days!)
         */
         unsigned long getCurStateDuration() const;
 
+        /**
+            @brief  Determines the duration the button is in the current state
+            @param  clock
+                    Time source (i.e. the clock of the matrix, see ButtonMatrix::getClock())
+            @return The duration in ms (roll over after ~50 days!)
+        */
+        unsigned long getCurStateDuration(ClockItf& clock) const;
+
+        /**
+            @brief  Determines the duration the button is in the current state
+            @param  now
+                    Current timestamp in ms (i.e. taken from the matrix clock)
+            @return The duration in ms (roll over after ~50 days!)
+        */
+        unsigned long getCurStateDuration(unsigned long now) const;
+
         /**
             @brief  Determines the duration the button was in the previous state
             @return The duration in ms (roll over after ~50 days!)
         */
         unsigned long getPrevStateDuration() const;
 
+#if BTNMATRIX_EVENT_MICROS
+        /**
+            @brief  Gets the time the state has changed last
+            @return Timestamp in us taken when the line of the button has been sampled
+        */
+        inline unsigned long getStateChangeMicros() const { return m_stateChangeMicros; }
+
+        /**
+            @brief  Sets the time the state has changed last (called by the ButtonMatrix)
+            @param  us
+                    Timestamp in us
+        */
+        inline void setStateChangeMicros(unsigned long us) { m_stateChangeMicros = us; }
+#endif
+
         /**
             @brief  Indicates to the button that the next rose transition shall (or shall not)
                     be notified as a state change
@@ -160,9 +221,21 @@ namespace RSys
             @brief  Updates the button with a new state.
                     If the state is different to the current state, the change will be notified!
                     (Left the method public to allow usage independent of the ButtonMatrix)
+            @param  newState
+                    State sampled during the scan
+            @param  now
+                    Timestamp in ms of the scan the state has been sampled in
+            @return True, if the state has changed or false if the new state is the same as the previous
+        */
+        virtual bool updateState(const BTN_STATE newState, const unsigned long now);
+
+        /**
+            @brief  Updates the button with a new state sampled now (see updateState(newState, now))
+            @param  newState
+                    State sampled
             @return True, if the state has changed or false if the new state is the same as the previous
         */
-        virtual bool updateState(const BTN_STATE newState);
+        inline bool updateState(const BTN_STATE newState) { return updateState(newState, NativeClock::getDefault().millis()); }
 
         /**
             @brief  Updates the buttons last executed action
@@ -179,7 +252,7 @@ namespace RSys
 
     private:
 
-        uint8_t m_buttonNo;     /** The buttons number */
+        btn_num_t   m_buttonNo;     /** The buttons number */
         BTN_STATE   m_curState;     /** The buttons current state */
         BTN_STATE   m_prevState;    /** The buttons previous state */
         mutable BTN_ACTION  m_lastAction;      /** The last action executed on the button */
@@ -188,6 +261,9 @@ namespace RSys
 
         unsigned long m_stateChangeMillis; /** Time a which the buttons state changed last */
         unsigned long m_prevStateDuration; /** The duration the button was in its previous state */
+#if BTNMATRIX_EVENT_MICROS
+        unsigned long m_stateChangeMicros; /** Time in us at which the state has been sampled to change last */
+#endif
 
         bool m_swallowNextRoseEvent;   /** Determines whether or not the next state change shall be swallowed and not be notified */
 
@@ -55,7 +55,8 @@ namespace RSys
             BTN_ACTION_NONE       = 0,   /** No button action */
             BTN_ACTION_CLICK      = 1,   /** Button has been click (notified when button is released) */
             //BTN_ACTION_DBL_CLICK  = 2,   --> not yet implemented
-            BTN_ACTION_LONG_PRESS = 3    /** Button has been pressed long */
+            BTN_ACTION_LONG_PRESS = 3,   /** Button has been pressed long */
+            BTN_ACTION_REPEAT     = 4    /** Held button has been repeated (typematic, notified at the repeat rate) */
         };
 
     /**
@@ -70,9 +71,13 @@ namespace RSys
             @brief  Updates the button with a new state.
                     If the state is different to the current state, the change will be notified!
                     (Left the method public to allow usage independent of the ButtonMatrix)
+            @param  newState
+                    State sampled during the scan
+            @param  now
+                    Timestamp in ms of the scan the state has been sampled in
             @return True, if the state has changed or false if the new state is the same as the previous
         */
-        virtual bool updateState(const BTN_STATE newState) = 0;
+        virtual bool updateState(const BTN_STATE newState, const unsigned long now) = 0;
 
         /**
             @brief  Updates the buttons last executed action
@@ -0,0 +1,124 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ButtonChord.h
+  -----------------------------------------------------------------------------
+  @brief        Key combination matched against the packed pressed-state bitmap
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ButtonChord_h
+#define ButtonChord_h
+
+#include <Arduino.h>
+#include "ButtonBaseItf.h"
+#include "KeySet.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Combination of buttons that have to be pressed together.
+               The chord is pressed as soon as all of its buttons are pressed and the last
+               one followed the first one within the time window. It is released as soon as
+               any of its buttons is released.
+               The chord is owned by the caller and has to outlive its registration
+               at the matrix (see ButtonMatrix::addChord())
+    */
+    class ButtonChord
+    {
+    public:
+
+        /**
+            @brief  Chord callback type
+            @param  void*
+                    Context pointer given on construction
+            @param  ButtonChord&
+                    The chord
+            @param  BTN_STATE
+                    BTN_STATE_PRESSED if the chord has been completed,
+                    BTN_STATE_RELEASED if it has been broken up
+        */
+        typedef void (*chordFnc)(void*, ButtonChord&, BTN_STATE);
+
+        /**
+            @brief  c'tor
+            @param  keys
+                    Buttons of the chord (declare the set as static object, it is not copied)
+            @param  cb
+                    Callback function
+            @param  window
+                    Maximum time in ms between the first and the last button press (0 for no limit)
+            @param  ctx
+                    Context pointer handed to the callback
+        */
+        ButtonChord(const KeySet& keys, chordFnc cb, uint16_t window = 0, void* ctx = NULL)
+        :   m_keys(keys),
+            m_callback(cb),
+            m_context(ctx),
+            m_window(window),
+            m_exclusive(false),
+            m_active(false),
+            m_touched(false),
+            m_firstPress(0),
+            m_pNext(NULL)
+        {
+        }
+
+        /**
+            @brief  Gets the buttons of the chord
+            @return Set of button indices
+        */
+        inline const KeySet& getKeys() const { return m_keys; }
+
+        /**
+            @brief  Requires that no other button is pressed when the chord is completed
+            @param  exclusive
+                    True to reject the chord if any other button is pressed
+        */
+        inline void setExclusive(bool exclusive = true) { m_exclusive = exclusive; }
+
+        /**
+            @brief  Gets the time window
+            @return Maximum time in ms between the first and the last button press (0 for no limit)
+        */
+        inline uint16_t getWindow() const { return m_window; }
+
+        /**
+            @brief  Determines if the chord is currently pressed
+            @return True if the chord has been completed and not broken up yet
+        */
+        inline bool isPressed() const { return m_active; }
+
+    private:
+
+        friend class ButtonMatrix;
+
+        const KeySet&   m_keys;         /** Buttons of the chord */
+        chordFnc        m_callback;     /** Callback function */
+        void*           m_context;      /** Context handed to the callback */
+        const uint16_t  m_window;       /** Maximum time in ms between the first and the last button press */
+        bool            m_exclusive;    /** No other buttons may be pressed */
+        bool            m_active;       /** Chord is pressed */
+        bool            m_touched;      /** Any button of the chord is pressed */
+        unsigned long   m_firstPress;   /** Time the first button of the chord has been pressed */
+        ButtonChord*    m_pNext;        /** Next chord registered at the same matrix */
+    };
+}
+
+
+#endif // ButtonChord_h
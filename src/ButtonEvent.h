@@ -0,0 +1,202 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ButtonEvent.h
+  -----------------------------------------------------------------------------
+  @brief        Compact record of a button change reported by the matrix
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ButtonEvent_h
+#define ButtonEvent_h
+
+#include <Arduino.h>
+#include "ButtonBaseItf.h"
+#include "ButtonMatrixConfig.h"
+#include "KeySet.h"
+#include "Keymap.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Kinds of button events (bit mask values for subscriptions)
+    */
+    enum BTN_EVENT_KIND : unsigned char
+    {
+        BTN_EVENT_FELL       = 0x01,    /** Button has been pressed */
+        BTN_EVENT_ROSE       = 0x02,    /** Button has been released */
+        BTN_EVENT_CLICK      = 0x04,    /** Button has been clicked */
+        BTN_EVENT_LONG_PRESS = 0x08,    /** Button has been pressed long */
+        BTN_EVENT_REPEAT     = 0x10,    /** Held button has been repeated */
+        BTN_EVENT_ALL        = 0x1F     /** All of the above */
+    };
+
+
+    /**
+        @brief Record of a single button change within a scan
+    */
+    struct ButtonEvent
+    {
+        uint16_t    idx;        /** Index of the button in the matrix */
+        BTN_STATE   state;      /** State of the button after the scan */
+        BTN_ACTION  action;     /** Action detected during the scan (BTN_ACTION_NONE for pure state changes) */
+        keycode_t   keyCode;    /** Key code resolved by the keymap of the matrix (BTN_KEY_NONE without keymap) */
+#if BTNMATRIX_EVENT_MICROS
+        unsigned long micros;   /** Time in us the line of the button has been sampled during the scan */
+#endif
+
+        /**
+            @brief  Gets the kind of the event
+            @return Kind of the event (single BTN_EVENT_KIND bit)
+        */
+        inline uint8_t getKind() const
+        {
+            return (BTN_ACTION_CLICK == action) ? BTN_EVENT_CLICK
+                 : (BTN_ACTION_LONG_PRESS == action) ? BTN_EVENT_LONG_PRESS
+                 : (BTN_ACTION_REPEAT == action) ? BTN_EVENT_REPEAT
+                 : (BTN_STATE_PRESSED == state) ? BTN_EVENT_FELL
+                 : BTN_EVENT_ROSE;
+        }
+    };
+
+
+
+#if BTNMATRIX_EVENT_MICROS
+    /**
+        @brief Key with two contacts (early and late make) wired as two matrix positions.
+               The time between both contacts determines the velocity of the key press.
+               Declare the pairs as static array, i.e. VelocityPair pairs[] = { {0, 1}, {2, 3} };
+    */
+    struct VelocityPair
+    {
+        uint16_t        early;          /** Index of the button closing first */
+        uint16_t        late;           /** Index of the button closing last */
+        unsigned long   earlyMicros;    /** Time in us the early contact has closed (maintained by the matrix) */
+        bool            armed;          /** Early contact closed, late contact pending (maintained by the matrix) */
+
+        /**
+            @brief  c'tor
+            @param  earlyIdx
+                    Index of the button closing first
+            @param  lateIdx
+                    Index of the button closing last
+        */
+        VelocityPair(uint16_t earlyIdx, uint16_t lateIdx)
+        :   early(earlyIdx),
+            late(lateIdx),
+            earlyMicros(0),
+            armed(false)
+        {
+        }
+    };
+
+
+    /**
+        @brief Record of a key press measured by a VelocityPair
+    */
+    struct VelocityEvent
+    {
+        uint16_t        idx;            /** Index of the early button of the pair */
+        uint8_t         velocity;       /** Velocity 1 (slowest) ... 127 (fastest) */
+        unsigned long   travelMicros;   /** Time in us between the early and the late contact */
+        unsigned long   micros;         /** Time in us the late contact has been sampled */
+    };
+#endif
+
+
+
+    /**
+        @brief Subscription of a callback to particular event kinds of particular buttons.
+               The subscription is owned by the caller and has to outlive its registration
+               at the matrix (see ButtonMatrix::subscribe())
+    */
+    class ButtonSubscription
+    {
+    public:
+
+        /**
+            @brief  Subscription callback type
+            @param  void*
+                    Context pointer given on construction
+            @param  const ButtonEvent&
+                    The event (fell: PRESSED/NONE, rose: RELEASED/NONE,
+                    click: RELEASED/CLICK, long press: PRESSED/LONG_PRESS, repeat: PRESSED/REPEAT)
+        */
+        typedef void (*subscriptionFnc)(void*, const ButtonEvent&);
+
+        /**
+            @brief  c'tor (the subscription contains all buttons of the matrix, see setKeys())
+            @param  cb
+                    Callback function
+            @param  eventMask
+                    Event kinds to subscribe to (combination of BTN_EVENT_KIND values)
+            @param  ctx
+                    Context pointer handed to the callback
+        */
+        ButtonSubscription(subscriptionFnc cb, uint8_t eventMask, void* ctx = NULL)
+        :   m_pKeys(NULL),
+            m_callback(cb),
+            m_context(ctx),
+            m_eventMask(eventMask),
+            m_pNext(NULL)
+        {
+        }
+
+        /**
+            @brief  Restricts the subscription to a set of buttons
+            @param  pKeys
+                    Set of button indices (declare it as static object, the set is not copied
+                    and can be changed any time, NULL for all buttons)
+        */
+        inline void setKeys(const KeySet* pKeys) { m_pKeys = pKeys; }
+
+        /**
+            @brief  Gets the subscribed buttons
+            @return Pointer to the set of button indices (NULL for all buttons)
+        */
+        inline const KeySet* getKeys() const { return m_pKeys; }
+
+        /**
+            @brief  Determines whether or not a button is subscribed
+            @param  idx
+                    Index of the button in the matrix
+            @return True if subscribed
+        */
+        inline bool hasKey(uint16_t idx) const { return NULL == m_pKeys || m_pKeys->test(idx); }
+
+        /**
+            @brief  Gets the subscribed event kinds
+            @return Combination of BTN_EVENT_KIND values
+        */
+        inline uint8_t getEventMask() const { return m_eventMask; }
+
+    private:
+
+        friend class ButtonMatrix;
+
+        const KeySet*       m_pKeys;        /** Subscribed buttons (NULL for all) */
+        subscriptionFnc     m_callback;     /** Callback function */
+        void*               m_context;      /** Context handed to the callback */
+        const uint8_t       m_eventMask;    /** Subscribed event kinds */
+        ButtonSubscription* m_pNext;        /** Next subscription registered at the same matrix */
+    };
+
+}
+
+
+#endif // ButtonEvent_h
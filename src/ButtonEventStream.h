@@ -0,0 +1,273 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ButtonEventStream.h
+  -----------------------------------------------------------------------------
+  @brief        Awaitable button events for C++20 coroutines
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ButtonEventStream_h
+#define ButtonEventStream_h
+
+#include <Arduino.h>
+#include "ButtonMatrix.h"
+
+// just available for C++20 builds with coroutine support (i.e. host or ESP32 builds)
+#if defined(__has_include) && __cplusplus >= 202002L
+    #if __has_include(<coroutine>)
+        #include <coroutine>
+        #define BTNMATRIX_HAS_COROUTINES
+    #endif
+#endif
+
+
+#ifdef BTNMATRIX_HAS_COROUTINES
+
+namespace RSys
+{
+    /**
+        @brief Queues the events of a matrix, so coroutines can co_await them
+               (co_await stream.nextEvent()). The events are fed by a subscription
+               during update(), the coroutines receiving them are resumed by resumePending()
+               after update() has returned, so they may call into the matrix (i.e. update(),
+               setButtonEnabled()) safely. Neither the queue nor the waiters allocate any memory
+        @tparam Capacity
+                Number of events queued while no coroutine is waiting for them
+                (the oldest event is dropped if the queue is full)
+    */
+    template <uint8_t Capacity>
+    class ButtonEventStream
+    {
+    public:
+
+        static const uint16_t anyKey = 0xFFFF;     /** Awaits the events of all buttons */
+
+        /**
+            @brief Awaitable of a single event (returned by nextEvent())
+        */
+        class Awaiter
+        {
+        public:
+
+            Awaiter(ButtonEventStream& stream, uint8_t eventMask, uint16_t key)
+            :   m_stream(stream),
+                m_eventMask(eventMask),
+                m_key(key),
+                m_pNext(NULL)
+            {
+            }
+
+            /** @brief Takes a queued event if available (no suspension) */
+            bool await_ready() { return m_stream.take(*this); }
+
+            /** @brief Waits for the next matching event */
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                m_handle = handle;
+                append(m_stream.m_pWaiters, *this);
+            }
+
+            /** @brief Returns the event */
+            ButtonEvent await_resume() const { return m_event; }
+
+            /**
+                @brief  Checks whether the awaiter waits for an event
+                @param  event
+                        The event
+                @return True if matching
+            */
+            inline bool matches(const ButtonEvent& event) const
+            {
+                return 0 != (event.getKind() & m_eventMask) && (anyKey == m_key || event.idx == m_key);
+            }
+
+        private:
+
+            friend class ButtonEventStream;
+
+            ButtonEventStream&      m_stream;       /** Stream the event is awaited from */
+            const uint8_t           m_eventMask;    /** Awaited event kinds */
+            const uint16_t          m_key;          /** Awaited button (anyKey for all) */
+            Awaiter*                m_pNext;        /** Next waiter of the stream (waiting or ready) */
+            std::coroutine_handle<> m_handle;       /** Waiting coroutine */
+            ButtonEvent             m_event;        /** The event */
+        };
+
+
+        /**
+            @brief  c'tor, subscribes to all buttons of the matrix
+            @param  matrix
+                    The matrix (init() does not need to be called yet)
+            @param  eventMask
+                    Event kinds to be queued (combination of BTN_EVENT_KIND values)
+        */
+        explicit ButtonEventStream(ButtonMatrix& matrix, uint8_t eventMask = BTN_EVENT_ALL)
+        :   m_matrix(matrix),
+            m_subscription(onEvent, eventMask, this),
+            m_head(0),
+            m_count(0),
+            m_pWaiters(NULL),
+            m_pReady(NULL)
+        {
+            m_matrix.subscribe(m_subscription);
+        }
+
+        /**
+            @brief  d'tor (coroutines still waiting are never resumed)
+        */
+        ~ButtonEventStream()
+        {
+            m_matrix.unsubscribe(m_subscription);
+        }
+
+        /**
+            @brief  Gets an awaitable of the next event
+                    (i.e. "ButtonEvent event = co_await stream.nextEvent(BTN_EVENT_CLICK);")
+            @param  eventMask
+                    Awaited event kinds (combination of BTN_EVENT_KIND values)
+            @param  key
+                    Awaited button (anyKey for all)
+            @return Awaitable
+        */
+        inline Awaiter nextEvent(uint8_t eventMask = BTN_EVENT_ALL, uint16_t key = anyKey)
+        {
+            return Awaiter(*this, eventMask, key);
+        }
+
+        /**
+            @brief  Gets the number of queued events
+            @return Number of events
+        */
+        inline uint8_t getNumQueued() const { return m_count; }
+
+        /**
+            @brief  Resumes the coroutines that have received an event during update(),
+                    in the order of the events (call it after each update() of the matrix,
+                    never from within a callback of the matrix)
+            @return Number of coroutines resumed
+        */
+        uint8_t resumePending()
+        {
+            uint8_t numResumed = 0;
+            while (NULL != m_pReady)
+            {
+                // unlink first, the coroutine may await the next event right away
+                Awaiter* pWaiter = m_pReady;
+                m_pReady = pWaiter->m_pNext;
+                pWaiter->m_pNext = NULL;
+                pWaiter->m_handle.resume();
+                numResumed++;
+            }
+            return numResumed;
+        }
+
+    private:
+
+        /**
+            @brief  Takes the first matching event from the queue
+            @param  waiter
+                    Awaiter receiving the event
+            @return True if an event has been found
+        */
+        bool take(Awaiter& waiter)
+        {
+            for (uint8_t pos = 0; pos < m_count; pos++)
+            {
+                const uint8_t slot = (m_head + pos) % Capacity;
+                if (waiter.matches(m_queue[slot]))
+                {
+                    waiter.m_event = m_queue[slot];
+
+                    // close the gap, the order of the remaining events is kept
+                    for (uint8_t next = pos + 1; next < m_count; next++)
+                    {
+                        m_queue[(m_head + next - 1) % Capacity] = m_queue[(m_head + next) % Capacity];
+                    }
+                    m_count--;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+            @brief  Appends a waiter to a list of waiters
+            @param  pList
+                    Head of the list
+            @param  waiter
+                    The waiter
+        */
+        static void append(Awaiter*& pList, Awaiter& waiter)
+        {
+            Awaiter** ppWaiter = &pList;
+            while (NULL != *ppWaiter)
+            {
+                ppWaiter = &(*ppWaiter)->m_pNext;
+            }
+            waiter.m_pNext = NULL;
+            *ppWaiter = &waiter;
+        }
+
+        /**
+            @brief  Subscription callback, hands the event to the first matching waiter
+                    (resumed by resumePending()) or queues it
+            @param  ctx
+                    The stream
+            @param  event
+                    The event
+        */
+        static void onEvent(void* ctx, const ButtonEvent& event)
+        {
+            ButtonEventStream* pStream = static_cast<ButtonEventStream*>(ctx);
+
+            for (Awaiter** ppWaiter = &pStream->m_pWaiters; NULL != *ppWaiter; ppWaiter = &(*ppWaiter)->m_pNext)
+            {
+                Awaiter* pWaiter = *ppWaiter;
+                if (pWaiter->matches(event))
+                {
+                    *ppWaiter = pWaiter->m_pNext;
+                    pWaiter->m_event = event;
+                    append(pStream->m_pReady, *pWaiter);
+                    return;
+                }
+            }
+
+            if (Capacity == pStream->m_count)
+            {
+                // drop the oldest event
+                pStream->m_head = (pStream->m_head + 1) % Capacity;
+                pStream->m_count--;
+            }
+            pStream->m_queue[(pStream->m_head + pStream->m_count) % Capacity] = event;
+            pStream->m_count++;
+        }
+
+
+        ButtonMatrix&       m_matrix;               /** The matrix */
+        ButtonSubscription  m_subscription;         /** Subscription feeding the stream */
+        ButtonEvent         m_queue[Capacity];      /** Ring buffer of the queued events */
+        uint8_t             m_head;                 /** Position of the oldest event */
+        uint8_t             m_count;                /** Number of queued events */
+        Awaiter*            m_pWaiters;             /** Waiting coroutines */
+        Awaiter*            m_pReady;               /** Coroutines with an event, resumed by resumePending() */
+    };
+}
+
+#endif // BTNMATRIX_HAS_COROUTINES
+
+#endif // ButtonEventStream_h
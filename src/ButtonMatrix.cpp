@@ -29,127 +29,1239 @@ namespace RSys
 
     ButtonMatrix::ButtonMatrix(
                         Button* buttons,
-                        uint8_t* rowPins, uint8_t* colPins,
+                        pin_t* rowPins, pin_t* colPins,
                         uint8_t numRows, uint8_t numCols,
-                        IOHandlerItf& ioItf)
+                        IOHandlerItf& ioItf,
+                        ClockItf& clock)
     //-----------------------------------------------------------------------------
     :   m_pButtons(buttons),
+        m_pStore(NULL),
         m_rowPins(rowPins),
         m_colPins(colPins),
         m_numRows(numRows),
         m_numCols(numCols),
         m_ioItf(ioItf),
+        m_clock(clock),
         m_scanInterval(s_defaultScanInterval),
         m_lastScan(0),
         m_LongPressMS(s_defaultLongPressMS),
         m_numButtons(numRows * numCols),
         m_invertInput(false),
+        m_orientation(SCAN_DRIVE_COLS),
+        m_diodes(DIODES_NONE),
+        m_driveRows(false),
+        m_driveMode(DRIVE_TRISTATE),
+        m_settleTime(0),
+        m_priorityInterval(0),
+        m_lastPriorityScan(0),
+        m_pAsyncIO(NULL),
+        m_asyncStep(ASYNC_IDLE),
+        m_asyncPriority(false),
+        m_asyncLine(KeySet::npos),
+        m_asyncStart(0),
+#if BTNMATRIX_EVENT_MICROS
+        m_pLineMicros(NULL),
+        m_lineMicrosValid(false),
+        m_scanStartMicros(0),
+        m_scanMicros(0),
+        m_pVelocityPairs(NULL),
+        m_numVelocityPairs(0),
+        m_velocityMinMicros(1000),
+        m_velocityMaxMicros(40000),
+        m_velocityCallback(NULL),
+        m_velocityContext(NULL),
+#endif
+        m_deadline(0),
+        m_deadlinePending(false),
+        m_pMemory(NULL),
+        m_ownsMemory(false),
+        m_pReadMask(NULL),
+        m_pReadBits(NULL),
+        m_pPriorityKeys(NULL),
+        m_pAutoRepeatKeys(NULL),
+        m_pRepeatTimings(NULL),
+        m_numRepeatTimings(0),
+        m_repeatDelay(500),
+        m_repeatRate(100),
+        m_repeatIdx(KeySet::npos),
+        m_curRepeatRate(100),
+        m_repeatDue(0),
+        m_repeating(false),
+        m_repeated(false),
+        m_pScanObserver(NULL),
         m_buttonActionCallback(NULL),
-        m_buttonEventCallback(NULL)
+        m_buttonEventCallback(NULL),
+        m_batchCallback(NULL),
+        m_batchContext(NULL),
+        m_pEvents(NULL),
+        m_maxEvents(0),
+        m_numEvents(0),
+        m_ownsEvents(false),
+        m_pSubscriptions(NULL),
+        m_subscribedKinds(0),
+        m_pChords(NULL),
+        m_pKeymap(NULL)
     {
+        // the memory is allocated the first time it is needed, so setMemory() can replace it
+    }
+
+
+    ButtonMatrix::ButtonMatrix(
+                        CompactButtonStore& store,
+                        pin_t* rowPins, pin_t* colPins,
+                        uint8_t numRows, uint8_t numCols,
+                        IOHandlerItf& ioItf,
+                        ClockItf& clock)
+    //-----------------------------------------------------------------------------
+    :   ButtonMatrix(NULL, rowPins, colPins, numRows, numCols, ioItf, clock)
+    {
+        m_pStore = &store;
+    }
+
+
+    ButtonMatrix::~ButtonMatrix()
+    //-----------------------------------------------------------------------------
+    {
+        releaseMemory();
+#ifndef BTNMATRIX_NO_HEAP
+        if (m_ownsEvents)
+        {
+            delete [] m_pEvents;
+        }
+#endif
+        m_pEvents = NULL;
+    }
+
+
+
+    bool ButtonMatrix::adoptMemory(KeySet::word_t* pWords, uint16_t numWords, unsigned long* pLineMicros, uint8_t numLineMicros)
+    //-----------------------------------------------------------------------------
+    {
+        bool ok = NULL != pWords && numWords >= getMemoryWords(m_numRows, m_numCols);
+#if BTNMATRIX_EVENT_MICROS
+        ok = ok && NULL != pLineMicros && numLineMicros >= getMaxLines();
+#else
+        (void)pLineMicros;
+        (void)numLineMicros;
+#endif
+        if (!ok)
+        {
+            return false;
+        }
+
+        KeySet* sets[s_numKeySets + s_numLineSets] =
+        {
+            &m_populatedKeys, &m_enabledKeys, &m_pressedKeys, &m_changedKeys,
+            &m_fellKeys, &m_roseKeys, &m_scratchKeys, &m_scanLines, &m_priorityLines
+        };
+        const uint16_t keyWords = KeySet::wordsFor(m_numButtons);
+        const uint16_t lineWords = KeySet::wordsFor(getMaxLines());
+
+        // the settings made so far move into the new memory
+        for (uint16_t w = 0; w < s_numKeySets * keyWords + s_numLineSets * lineWords; w++)
+        {
+            pWords[w] = (NULL != m_pMemory) ? m_pMemory[w] : 0;
+        }
+        const bool initial = NULL == m_pMemory;
+        releaseMemory();
+
+        KeySet::word_t* pSetWords = pWords;
+        for (uint8_t set = 0; set < s_numKeySets + s_numLineSets; set++)
+        {
+            const uint16_t setWords = (set < s_numKeySets) ? keyWords : lineWords;
+            sets[set]->attach(pSetWords, setWords);
+            pSetWords += setWords;
+        }
+        m_pReadMask = (uint8_t*)pSetWords;
+        m_pReadBits = m_pReadMask + (getMaxLines() + 7) / 8;
+        m_pMemory = pWords;
+#if BTNMATRIX_EVENT_MICROS
+        m_pLineMicros = pLineMicros;
+#endif
+
+        if (initial)
+        {
+            // all positions are populated and enabled by default
+            for (uint16_t idx = 0; idx < m_numButtons; idx++)
+            {
+                m_populatedKeys.set(idx);
+                m_enabledKeys.set(idx);
+            }
+            updateScanKeys();
+        }
+
+        return true;
+    }
+
+
+
+    bool ButtonMatrix::ensureMemory()
+    //-----------------------------------------------------------------------------
+    {
+#ifndef BTNMATRIX_NO_HEAP
+        if (NULL == m_pMemory)
+        {
+            const uint16_t numWords = getMemoryWords(m_numRows, m_numCols);
+            KeySet::word_t* pWords = new KeySet::word_t[numWords];
+#if BTNMATRIX_EVENT_MICROS
+            unsigned long* pLineMicros = new unsigned long[getMaxLines()];
+#else
+            unsigned long* pLineMicros = NULL;
+#endif
+            if (adoptMemory(pWords, numWords, pLineMicros, getMaxLines()))
+            {
+                m_ownsMemory = true;
+            }
+            else
+            {
+                // out of memory
+                delete [] pWords;
+                delete [] pLineMicros;
+            }
+        }
+#endif
+        return NULL != m_pMemory;
+    }
+
+
+
+    void ButtonMatrix::releaseMemory()
+    //-----------------------------------------------------------------------------
+    {
+#ifndef BTNMATRIX_NO_HEAP
+        if (m_ownsMemory)
+        {
+            delete [] m_pMemory;
+#if BTNMATRIX_EVENT_MICROS
+            delete [] m_pLineMicros;
+#endif
+        }
+#endif
+        m_ownsMemory = false;
     }
 
 
     void ButtonMatrix::setScanInterval(uint16_t scanInterval)
     //-----------------------------------------------------------------------------
     {
-        m_scanInterval = scanInterval;
+        m_scanInterval = scanInterval;
+    }
+
+
+    void ButtonMatrix::setInvertInput(bool invertInput)
+    //-----------------------------------------------------------------------------
+    {
+        m_invertInput = invertInput;
+    }
+
+
+
+    void ButtonMatrix::setScanOrientation(SCAN_ORIENTATION orientation, DIODE_DIRECTION diodes)
+    //-----------------------------------------------------------------------------
+    {
+        m_orientation = orientation;
+        m_diodes = diodes;
+        resolveOrientation();
+        updateScanKeys();
+    }
+
+
+
+    uint16_t ButtonMatrix::calibrateSettleTime(uint16_t refKey, uint16_t maxUs, uint8_t repeats)
+    //-----------------------------------------------------------------------------
+    {
+        // just the reference button is closed, anything else read is a ghost
+        KeySet& raw = m_scratchKeys;
+
+        raw.clear();
+        scan(raw, m_scanLines, maxUs);
+        if (refKey >= m_numButtons || !raw.test(refKey) || 1 != raw.count())
+        {
+            // reference button not closed (or ghosts even with the maximum settle time)
+            return m_settleTime;
+        }
+
+        // search the shortest settle time reading the reference alone in all repetitions
+        // (the ghosts are assumed to disappear once the lines are settled)
+        uint16_t lo = 0;
+        uint16_t hi = maxUs;
+        while (lo < hi)
+        {
+            const uint16_t mid = lo + (hi - lo) / 2;
+            bool stable = true;
+            for (uint8_t rep = 0; rep < repeats && stable; rep++)
+            {
+                raw.clear();
+                scan(raw, m_scanLines, mid);
+                stable = raw.test(refKey) && 1 == raw.count();
+            }
+
+            if (stable)
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+
+        m_settleTime = hi;
+        return m_settleTime;
+    }
+
+
+
+    bool ButtonMatrix::init()
+    //-----------------------------------------------------------------------------
+    {
+        bool ok = ensureMemory() && m_ioItf.isValid();
+        if (NULL != m_pStore)
+        {
+            ok = ok && m_numButtons <= m_pStore->getNumKeys();
+            m_pStore->setClock(m_clock);
+            m_pStore->reset(m_clock.millis());
+        }
+        else
+        {
+            const unsigned long now = m_clock.millis();
+            for (uint16_t idx = 0; idx < m_numButtons; idx++)
+            {
+                m_pButtons[idx].startInitialState(now);
+            }
+        }
+
+        // buttons disabled in advance are not scanned
+        if (ok)
+        {
+            for (uint16_t idx = 0; idx < m_numButtons; idx++)
+            {
+                m_enabledKeys.set(idx, (NULL != m_pStore) ? m_pStore->isEnabled(idx) : m_pButtons[idx].isEnabled());
+            }
+        }
+        updateScanKeys();
+        resolveOrientation();
+        updateScanKeys();
+
+        // asynchronous scans if the IO handler supports them
+        m_pAsyncIO = m_ioItf.asAsync();
+        m_asyncStep = ASYNC_IDLE;
+
+        configurePins();
+
+        return ok;
+    }
+
+
+
+    void ButtonMatrix::reinit()
+    //-----------------------------------------------------------------------------
+    {
+        // the IO expander may have been reset, nothing cached from it is valid anymore
+        m_ioItf.invalidate();
+        configurePins();
+    }
+
+
+
+    void ButtonMatrix::configurePins()
+    //-----------------------------------------------------------------------------
+    {
+        const pin_t*  readPins  = m_driveRows ? m_colPins : m_rowPins;
+        const uint8_t numRead   = m_driveRows ? m_numCols : m_numRows;
+        const pin_t*  drivePins = m_driveRows ? m_rowPins : m_colPins;
+        const uint8_t numDrive  = m_driveRows ? m_numRows : m_numCols;
+
+        // set all read pins as INPUT_PULLUP
+        m_ioItf.pinModeMulti(readPins, numRead, INPUT_PULLUP);
+
+        // set all drive pins to HIGH and then as INPUT
+        // the update routine will set them later as
+        // necessary (in push-pull mode they stay OUTPUT)
+        m_ioItf.digitalWriteMulti(drivePins, numDrive, HIGH);
+        m_ioItf.pinModeMulti(drivePins, numDrive, (DRIVE_PUSH_PULL == m_driveMode) ? OUTPUT : INPUT);
+    }
+
+
+
+    bool ButtonMatrix::update()
+    //-----------------------------------------------------------------------------
+    {
+        bool hasAnyButtonChanged = false;
+
+        // sample the clock just once, so all buttons of a scan share the same timestamp
+        const unsigned long now = m_clock.millis();
+
+        // changes are only reported for the update they occurred in
+        m_changedKeys.clear();
+        m_fellKeys.clear();
+        m_roseKeys.clear();
+        m_repeated = false;
+
+        if (isScanBusy())
+        {
+            // asynchronous scan in progress -> continue as far as the transfers have completed
+            if (advanceAsyncScan())
+            {
+                hasAnyButtonChanged = completeScan(m_asyncPriority, m_asyncStart);
+            }
+        }
+        // just scan if the minimum scan interval has elapsed
+        else if (now - m_lastScan >= m_scanInterval)
+        {
+            m_scratchKeys.clear();
+
+            // lets remember our last scan timestamp
+            m_lastScan = now;
+            m_lastPriorityScan = now;
+
+            hasAnyButtonChanged = startScan(false, now);
+        }
+        else if (m_priorityLines.any() && now - m_lastPriorityScan >= m_priorityInterval)
+        {
+            // just scan the lines of the priority buttons, the others keep their last state
+            m_lastPriorityScan = now;
+            m_scratchKeys = m_pressedKeys;
+
+            hasAnyButtonChanged = startScan(true, now);
+        }
+        else if (m_deadlinePending && (long)(now - m_deadline) >= 0)
+        {
+            // a long press or repeat is due before the next scan
+            processDeadline(now);
+        }
+
+        return hasAnyButtonChanged;
+    }
+
+
+
+    unsigned long ButtonMatrix::getTimeToNextUpdate() const
+    //-----------------------------------------------------------------------------
+    {
+        const unsigned long now = m_clock.millis();
+        const unsigned long sinceScan = now - m_lastScan;
+        unsigned long wait = (sinceScan >= m_scanInterval || isScanBusy()) ? 0 : m_scanInterval - sinceScan;
+
+        if (m_priorityLines.any())
+        {
+            const unsigned long sincePriorityScan = now - m_lastPriorityScan;
+            const unsigned long waitPriority = (sincePriorityScan >= m_priorityInterval) ? 0 : m_priorityInterval - sincePriorityScan;
+            if (waitPriority < wait)
+            {
+                wait = waitPriority;
+            }
+        }
+
+        if (m_deadlinePending)
+        {
+            const long toDeadline = (long)(m_deadline - now);
+            if (toDeadline <= 0)
+            {
+                wait = 0;
+            }
+            else if ((unsigned long)toDeadline < wait)
+            {
+                wait = (unsigned long)toDeadline;
+            }
+        }
+
+        return wait;
+    }
+
+
+
+    bool ButtonMatrix::startScan(bool priority, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        const KeySet& lines = priority ? m_priorityLines : m_scanLines;
+        bool hasAnyButtonChanged = false;
+
+#if BTNMATRIX_EVENT_MICROS
+        m_scanStartMicros = m_clock.micros();
+#endif
+
+        if (NULL != m_pAsyncIO)
+        {
+            m_asyncPriority = priority;
+            m_asyncStart = now;
+            m_asyncLine = lines.findFirst();
+            m_asyncStep = ASYNC_DRIVE;
+
+            if (advanceAsyncScan())
+            {
+                hasAnyButtonChanged = completeScan(priority, now);
+            }
+        }
+        else
+        {
+            scan(m_scratchKeys, lines, m_settleTime);
+            hasAnyButtonChanged = completeScan(priority, now);
+        }
+
+        return hasAnyButtonChanged;
+    }
+
+
+
+    bool ButtonMatrix::completeScan(bool priority, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+#if BTNMATRIX_EVENT_MICROS
+        if (!priority)
+        {
+            m_scanMicros = m_clock.micros() - m_scanStartMicros;
+        }
+#else
+        (void)priority;
+#endif
+
+        if (NULL != m_pScanObserver)
+        {
+            m_pScanObserver->onScan(m_scratchKeys, now);
+        }
+
+#if BTNMATRIX_EVENT_MICROS
+        m_lineMicrosValid = true;
+        const bool hasAnyButtonChanged = processScan(m_scratchKeys, now);
+        m_lineMicrosValid = false;
+        return hasAnyButtonChanged;
+#else
+        return processScan(m_scratchKeys, now);
+#endif
+    }
+
+
+
+    bool ButtonMatrix::advanceAsyncScan()
+    //-----------------------------------------------------------------------------
+    {
+        const pin_t*  drivePins = m_driveRows ? m_rowPins : m_colPins;
+        const pin_t*  readPins  = m_driveRows ? m_colPins : m_rowPins;
+        const uint8_t numRead   = m_driveRows ? m_numCols : m_numRows;
+        const bool    tristate  = DRIVE_TRISTATE == m_driveMode;
+        uint8_t*      readMask  = m_pReadMask;
+        uint8_t*      readBits  = m_pReadBits;
+        bool progress = true;
+
+        // advance as long as the transfers complete without waiting
+        while (progress && ASYNC_IDLE != m_asyncStep)
+        {
+            switch (m_asyncStep)
+            {
+                case ASYNC_DRIVE:
+                    if (KeySet::npos == m_asyncLine)
+                    {
+                        // all lines scanned
+                        m_asyncStep = ASYNC_IDLE;
+                        return true;
+                    }
+                    buildReadMask(m_asyncLine, readMask);
+                    if (tristate)
+                    {
+                        m_ioItf.pinMode(drivePins[m_asyncLine], OUTPUT);
+                    }
+                    progress = m_pAsyncIO->startDriveAndRead(drivePins[m_asyncLine], LOW, m_settleTime, readPins, numRead, readMask);
+                    if (progress)
+                    {
+                        m_asyncStep = ASYNC_READ;
+                    }
+                    break;
+
+                case ASYNC_READ:
+                    progress = m_pAsyncIO->poll(readBits);
+                    if (progress)
+                    {
+                        sampleLineMicros(m_asyncLine);
+                        buildReadMask(m_asyncLine, readMask);
+                        mergeReadBits(m_scratchKeys, m_asyncLine, readMask, readBits);
+                        m_asyncStep = ASYNC_RELEASE;
+                    }
+                    break;
+
+                case ASYNC_RELEASE:
+                    progress = m_pAsyncIO->startDigitalWrite(drivePins[m_asyncLine], HIGH);
+                    if (progress)
+                    {
+                        m_asyncStep = ASYNC_RELEASING;
+                    }
+                    break;
+
+                case ASYNC_RELEASING:
+                    progress = m_pAsyncIO->poll(readBits);
+                    if (progress)
+                    {
+                        if (tristate)
+                        {
+                            m_ioItf.pinMode(drivePins[m_asyncLine], INPUT);
+                        }
+                        m_asyncLine = (m_asyncPriority ? m_priorityLines : m_scanLines).findNext(m_asyncLine);
+                        m_asyncStep = ASYNC_DRIVE;
+                    }
+                    break;
+
+                default:
+                    m_asyncStep = ASYNC_IDLE;
+                    break;
+            }
+        }
+
+        return false;
+    }
+
+
+
+    void ButtonMatrix::sampleLineMicros(uint16_t line)
+    //-----------------------------------------------------------------------------
+    {
+#if BTNMATRIX_EVENT_MICROS
+        if (NULL != m_pLineMicros && line < getMaxLines())
+        {
+            m_pLineMicros[line] = m_clock.micros();
+        }
+#else
+        (void)line;
+#endif
+    }
+
+
+
+    void ButtonMatrix::processVelocity(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+#if BTNMATRIX_EVENT_MICROS
+        for (uint8_t idx = 0; idx < m_numVelocityPairs; idx++)
+        {
+            VelocityPair& pair = m_pVelocityPairs[idx];
+
+            if (m_fellKeys.test(pair.early))
+            {
+                pair.earlyMicros = getSampleMicros(pair.early, now);
+                pair.armed = true;
+            }
+
+            if (m_fellKeys.test(pair.late))
+            {
+                VelocityEvent evt;
+                evt.idx = pair.early;
+                evt.micros = getSampleMicros(pair.late, now);
+                // both contacts within the same sample -> fastest press
+                evt.travelMicros = (pair.armed && (long)(evt.micros - pair.earlyMicros) > 0) ? evt.micros - pair.earlyMicros : 0;
+
+                if (evt.travelMicros <= m_velocityMinMicros)
+                {
+                    evt.velocity = 127;
+                }
+                else if (evt.travelMicros >= m_velocityMaxMicros)
+                {
+                    evt.velocity = 1;
+                }
+                else
+                {
+                    evt.velocity = 127 - (uint8_t)((126UL * (evt.travelMicros - m_velocityMinMicros))
+                                                   / (m_velocityMaxMicros - m_velocityMinMicros));
+                }
+                pair.armed = false;
+
+                if (NULL != m_velocityCallback)
+                {
+                    m_velocityCallback(m_velocityContext, evt);
+                }
+            }
+            else if (m_roseKeys.test(pair.early))
+            {
+                // released before the late contact has closed
+                pair.armed = false;
+            }
+        }
+#else
+        (void)now;
+#endif
+    }
+
+
+
+    void ButtonMatrix::buildReadMask(uint16_t line, uint8_t* mask) const
+    //-----------------------------------------------------------------------------
+    {
+        const uint8_t  numRead     = m_driveRows ? m_numCols : m_numRows;
+        const uint16_t driveStride = m_driveRows ? m_numCols : 1;
+        const uint16_t readStride  = m_driveRows ? 1 : m_numCols;
+
+        // just read the populated and enabled positions
+        for (uint8_t readLine = 0; readLine < numRead; readLine++)
+        {
+            const uint8_t bit = 1 << (readLine & 7);
+            if (0 == (readLine & 7))
+            {
+                mask[readLine >> 3] = 0;
+            }
+            const uint16_t idx = line * driveStride + readLine * readStride;
+            if (m_populatedKeys.test(idx) && m_enabledKeys.test(idx))
+            {
+                mask[readLine >> 3] |= bit;
+            }
+        }
+    }
+
+
+
+    void ButtonMatrix::mergeReadBits(KeySet& raw, uint16_t line, const uint8_t* mask, const uint8_t* bits) const
+    //-----------------------------------------------------------------------------
+    {
+        const int      pressedLevel = m_invertInput ? HIGH : LOW;
+        const uint8_t  numRead      = m_driveRows ? m_numCols : m_numRows;
+        const uint16_t driveStride  = m_driveRows ? m_numCols : 1;
+        const uint16_t readStride   = m_driveRows ? 1 : m_numCols;
+
+        for (uint8_t readLine = 0; readLine < numRead; readLine++)
+        {
+            const uint8_t bit = 1 << (readLine & 7);
+            const int level = (bits[readLine >> 3] & bit) ? HIGH : LOW;
+            raw.set(line * driveStride + readLine * readStride,
+                    (mask[readLine >> 3] & bit) && level == pressedLevel);
+        }
+    }
+
+
+
+    void ButtonMatrix::scan(KeySet& raw, const KeySet& lines, uint16_t settleUs)
+    //-----------------------------------------------------------------------------
+    {
+        const pin_t*  drivePins = m_driveRows ? m_rowPins : m_colPins;
+        const pin_t*  readPins  = m_driveRows ? m_colPins : m_rowPins;
+        const uint8_t numRead   = m_driveRows ? m_numCols : m_numRows;
+        const bool    tristate  = DRIVE_TRISTATE == m_driveMode;
+        uint8_t*      readMask  = m_pReadMask;
+        uint8_t*      readBits  = m_pReadBits;
+
+        // iterate through all drive lines requested
+        for (uint16_t line = lines.findFirst(); KeySet::npos != line; line = lines.findNext(line))
+        {
+            buildReadMask(line, readMask);
+
+            // set pin mode for the current drive pin to OUTPUT
+            if (tristate)
+            {
+                m_ioItf.pinMode(drivePins[line], OUTPUT);
+            }
+            // pull down the output pin and read all read lines
+            m_ioItf.driveAndRead(drivePins[line], LOW, settleUs, readPins, numRead, readMask, readBits);
+            // one timestamp per line, taken right after sampling
+            sampleLineMicros(line);
+            mergeReadBits(raw, line, readMask, readBits);
+
+            // set drive pin to HIGH and INPUT again
+            // necessary to allow detection of multiple buttons pressed in the
+            // same read line and not causing a short in this situation
+            // (not necessary if diodes or open-drain outputs prevent the short)
+            m_ioItf.digitalWrite(drivePins[line], HIGH);
+            if (tristate)
+            {
+                m_ioItf.pinMode(drivePins[line], INPUT);
+            }
+        }
+    }
+
+
+
+    bool ButtonMatrix::processScan(const KeySet& raw, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        bool hasAnyButtonChanged = false;
+
+        // determine the edges of this scan on the packed bitmaps
+        m_changedKeys = raw;
+        m_changedKeys ^= m_pressedKeys;
+        m_pressedKeys = raw;
+        for (uint16_t idx = m_changedKeys.findFirst(); KeySet::npos != idx; idx = m_changedKeys.findNext(idx))
+        {
+            // disabled buttons do not report any change
+            if (idx >= m_numButtons
+                || ((NULL != m_pStore) ? !m_pStore->isEnabled(idx) : !m_pButtons[idx].isEnabled()))
+            {
+                m_changedKeys.reset(idx);
+            }
+        }
+        m_fellKeys = m_changedKeys;
+        m_fellKeys &= m_pressedKeys;
+        m_roseKeys = m_changedKeys;
+        m_roseKeys -= m_pressedKeys;
+
+        updateRepeat(now);
+
+        if (NULL != m_pKeymap)
+        {
+            // resolve the key codes once per change, the events just look them up
+            for (uint16_t idx = m_changedKeys.findFirst(); KeySet::npos != idx; idx = m_changedKeys.findNext(idx))
+            {
+                if (m_fellKeys.test(idx))
+                {
+                    m_pKeymap->press(idx);
+                }
+                else
+                {
+                    m_pKeymap->release(idx);
+                }
+            }
+        }
+
+        for (uint16_t idx = 0; idx < m_numButtons; idx++)
+        {
+            BTN_STATE state = m_pressedKeys.test(idx) ? BTN_STATE_PRESSED : BTN_STATE_RELEASED;
+            bool bChanged = false;
+
+            if (NULL != m_pStore)
+            {
+                bChanged = m_pStore->updateState(idx, state, now);
+            }
+            else
+            {
+                Button* pBut = &m_pButtons[idx];
+                bChanged = static_cast<ButtonBaseItf*>(pBut)->updateState(state, now);
+#if BTNMATRIX_EVENT_MICROS
+                if (m_changedKeys.test(idx))
+                {
+                    pBut->setStateChangeMicros(getSampleMicros(idx, now));
+                }
+#endif
+                if (bChanged && NULL != m_buttonEventCallback)
+                {
+                    // The state of the button has changed and a callback function is registered -> lets notify
+                    m_buttonEventCallback(*pBut);
+                }
+            }
+
+            // we need to report back if any button has changed its state
+            hasAnyButtonChanged = hasAnyButtonChanged || bChanged;
+        }
+
+        // the state changes are notified before the actions they cause
+        dispatchSubscriptions(now);
+
+        // actions are only determined if anybody is interested in them
+        if (hasActionObservers())
+        {
+            // clicks only occur for the buttons that changed, long presses and repeats
+            // of the buttons being held are not due before the deadline
+            // (the raw state has been taken over, so its set is free again)
+            KeySet& candidates = m_scratchKeys;
+            candidates = m_changedKeys;
+            if (m_deadlinePending && (long)(now - m_deadline) >= 0)
+            {
+                candidates |= m_pressedKeys;
+            }
+            if (m_repeated)
+            {
+                candidates.set(m_repeatIdx);
+            }
+            processActions(candidates, now);
+        }
+
+        if (NULL != m_pStore)
+        {
+            m_pStore->age(now);
+        }
+
+        if (KeySet::npos != m_repeatIdx && !m_pressedKeys.test(m_repeatIdx))
+        {
+            // repeated button released
+            m_repeatIdx = KeySet::npos;
+        }
+
+#if BTNMATRIX_EVENT_MICROS
+        processVelocity(now);
+#endif
+        if (m_changedKeys.any())
+        {
+            processChords(now);
+        }
+        flushEvents();
+        updateDeadline(now);
+
+        return hasAnyButtonChanged;
+    }
+
+
+
+    void ButtonMatrix::processDeadline(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        // nothing has been scanned, so just the repeat or the long presses can be due
+        updateRepeat(now);
+
+        if (hasActionObservers())
+        {
+            KeySet& due = m_scratchKeys;
+            due.clear();
+            if (m_repeated)
+            {
+                due.set(m_repeatIdx);
+            }
+            for (uint16_t idx = m_pressedKeys.findFirst(); KeySet::npos != idx && idx < m_numButtons; idx = m_pressedKeys.findNext(idx))
+            {
+                const unsigned long duration = (NULL != m_pStore)
+                                                ? m_pStore->getCurStateDuration(idx, now)
+                                                : m_pButtons[idx].getCurStateDuration(now);
+                if (duration >= m_LongPressMS)
+                {
+                    due.set(idx);
+                }
+            }
+            processActions(due, now);
+        }
+
+        if (NULL != m_pStore)
+        {
+            m_pStore->age(now);
+        }
+
+        flushEvents();
+        updateDeadline(now);
+    }
+
+
+
+    bool ButtonMatrix::hasActionObservers() const
+    //-----------------------------------------------------------------------------
+    {
+        return NULL != m_batchCallback
+               || (NULL != m_buttonActionCallback && NULL == m_pStore)
+               || 0 != (m_subscribedKinds & (BTN_EVENT_CLICK | BTN_EVENT_LONG_PRESS | BTN_EVENT_REPEAT));
+    }
+
+
+
+    void ButtonMatrix::processActions(const KeySet& candidates, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        for (uint16_t idx = candidates.findFirst(); KeySet::npos != idx && idx < m_numButtons; idx = candidates.findNext(idx))
+        {
+            const BTN_STATE state = m_pressedKeys.test(idx) ? BTN_STATE_PRESSED : BTN_STATE_RELEASED;
+            const BTN_ACTION action = detectAction(idx, state, now);
+            if (BTN_ACTION_NONE != action && NULL != m_buttonActionCallback && NULL == m_pStore)
+            {
+                m_buttonActionCallback(m_pButtons[idx]);
+            }
+            if (NULL != m_batchCallback && (BTN_ACTION_NONE != action || m_changedKeys.test(idx)))
+            {
+                pushEvent(idx, state, action, now);
+            }
+            if (BTN_ACTION_NONE != action && 0 != m_subscribedKinds)
+            {
+                dispatchAction(idx, state, action, now);
+            }
+        }
+    }
+
+
+
+    BTN_ACTION ButtonMatrix::detectAction(uint16_t idx, BTN_STATE state, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        BTN_ACTION action = BTN_ACTION_NONE;
+        // clicks are only notified for the scan the button has been released in (and not after repeats)
+        const bool released = BTN_STATE_RELEASED == state && m_changedKeys.test(idx)
+                              && !(idx == m_repeatIdx && m_repeating);
+
+        if (NULL != m_pStore)
+        {
+            if (released && m_pStore->doNotifyClick(idx))
+            {
+                action = BTN_ACTION_CLICK;
+            }
+            else if (m_pStore->isLongPressed(idx, m_LongPressMS, now))
+            {
+                action = BTN_ACTION_LONG_PRESS;
+            }
+            else if (m_repeated && idx == m_repeatIdx)
+            {
+                action = BTN_ACTION_REPEAT;
+            }
+            if (BTN_ACTION_NONE != action)
+            {
+                m_pStore->updateAction(idx, action);
+            }
+        }
+        else
+        {
+            Button* pBut = &m_pButtons[idx];
+            auto pBtnItf = static_cast<ButtonBaseItf*>(pBut);
+            if (released && pBtnItf->doNotifyClick())
+            {
+                // Button has been released -> send a click event
+                action = BTN_ACTION_CLICK;
+            }
+            else if (pBut->isLongPressed(m_LongPressMS, now))
+            {
+                action = BTN_ACTION_LONG_PRESS;
+            }
+            else if (m_repeated && idx == m_repeatIdx)
+            {
+                action = BTN_ACTION_REPEAT;
+            }
+            if (BTN_ACTION_NONE != action)
+            {
+                pBtnItf->updateAction(action);
+            }
+        }
+
+        if (idx == m_repeatIdx && BTN_ACTION_REPEAT != action)
+        {
+            // the long press takes precedence over a repeat due in the same scan
+            m_repeated = false;
+        }
+
+        return action;
+    }
+
+
+
+    void ButtonMatrix::getScannedKeys(KeySet& keys) const
+    //-----------------------------------------------------------------------------
+    {
+        keys = m_populatedKeys;
+        keys &= m_enabledKeys;
+    }
+
+
+
+    void ButtonMatrix::updateScanKeys()
+    //-----------------------------------------------------------------------------
+    {
+        m_scanLines.clear();
+        m_priorityLines.clear();
+        for (uint16_t idx = m_populatedKeys.findFirst(); KeySet::npos != idx && idx < m_numButtons; idx = m_populatedKeys.findNext(idx))
+        {
+            if (!m_enabledKeys.test(idx))
+            {
+                continue;
+            }
+            const uint16_t line = m_driveRows ? idx / m_numCols : idx % m_numCols;
+            m_scanLines.set(line);
+            if (NULL != m_pPriorityKeys && m_pPriorityKeys->test(idx))
+            {
+                m_priorityLines.set(line);
+            }
+        }
+    }
+
+
+    void ButtonMatrix::updateDeadline(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        unsigned long minRemaining = 0;
+        m_deadlinePending = false;
+
+        // the earliest long press of the buttons being pressed
+        for (uint16_t idx = m_pressedKeys.findFirst(); KeySet::npos != idx && idx < m_numButtons; idx = m_pressedKeys.findNext(idx))
+        {
+            const unsigned long duration = (NULL != m_pStore)
+                                            ? m_pStore->getCurStateDuration(idx, now)
+                                            : m_pButtons[idx].getCurStateDuration(now);
+            if (duration < m_LongPressMS)
+            {
+                const unsigned long remaining = m_LongPressMS - duration;
+                if (!m_deadlinePending || remaining < minRemaining)
+                {
+                    minRemaining = remaining;
+                    m_deadlinePending = true;
+                }
+            }
+        }
+
+        // the next repeat of the button being repeated
+        if (KeySet::npos != m_repeatIdx)
+        {
+            const unsigned long remaining = ((long)(m_repeatDue - now) > 0) ? m_repeatDue - now : 0;
+            if (!m_deadlinePending || remaining < minRemaining)
+            {
+                minRemaining = remaining;
+                m_deadlinePending = true;
+            }
+        }
+
+        m_deadline = now + minRemaining;
+    }
+
+
+    void ButtonMatrix::resolveOrientation()
+    //-----------------------------------------------------------------------------
+    {
+        if (DIODES_NONE != m_diodes)
+        {
+            // the diodes only let the current flow in one direction
+            m_driveRows = DIODES_COL2ROW == m_diodes;
+        }
+        else if (SCAN_AUTO == m_orientation)
+        {
+            // count the lines of both dimensions having buttons to be scanned
+            // (the line sets are recalculated by updateScanKeys() afterwards)
+            KeySet& rows = m_scanLines;
+            KeySet& cols = m_priorityLines;
+            rows.clear();
+            cols.clear();
+            for (uint16_t idx = m_populatedKeys.findFirst(); KeySet::npos != idx && idx < m_numButtons; idx = m_populatedKeys.findNext(idx))
+            {
+                if (m_enabledKeys.test(idx))
+                {
+                    rows.set(idx / m_numCols);
+                    cols.set(idx % m_numCols);
+                }
+            }
+            // each drive line costs a drive/restore cycle, so drive the smaller dimension
+            // (columns in case of a tie to keep the classic wiring)
+            m_driveRows = rows.count() < cols.count();
+        }
+        else
+        {
+            m_driveRows = SCAN_DRIVE_ROWS == m_orientation;
+        }
     }
 
 
-    void ButtonMatrix::setInvertInput(bool invertInput)
+
+    void ButtonMatrix::pushEvent(uint16_t idx, BTN_STATE state, BTN_ACTION action, unsigned long now)
     //-----------------------------------------------------------------------------
     {
-        m_invertInput = invertInput;
+        ButtonEvent evt;
+        evt.idx = idx;
+        evt.state = state;
+        evt.action = action;
+        evt.keyCode = (NULL != m_pKeymap) ? m_pKeymap->getKeyCode(idx) : (keycode_t)BTN_KEY_NONE;
+#if BTNMATRIX_EVENT_MICROS
+        evt.micros = getSampleMicros(idx, now);
+#else
+        (void)now;
+#endif
+
+        if (0 == m_maxEvents)
+        {
+            // no buffer -> each event on its own
+            m_batchCallback(m_batchContext, &evt, 1);
+            return;
+        }
+
+        if (m_numEvents >= m_maxEvents)
+        {
+            flushEvents();
+        }
+        m_pEvents[m_numEvents++] = evt;
     }
 
 
 
-    bool ButtonMatrix::init()
+    unsigned long ButtonMatrix::getSampleMicros(uint16_t idx, unsigned long now) const
     //-----------------------------------------------------------------------------
     {
-        // set all row pins as INPUT_PULLUP
-        for (uint8_t row = 0; row < m_numRows; row++)
+#if BTNMATRIX_EVENT_MICROS
+        if (m_lineMicrosValid)
         {
-            m_ioItf.pinMode(m_rowPins[row], INPUT_PULLUP);
+            const uint16_t line = m_driveRows ? idx / m_numCols : idx % m_numCols;
+            return m_pLineMicros[line];
         }
+#else
+        (void)idx;
+#endif
+        // no line timestamps (i.e. replayed scans)
+        return now * 1000UL;
+    }
 
-        // set all col pins to HIGH and then as INPUT
-        // the update routine will set them later as
-        // necessary
-        for (uint8_t col = 0; col < m_numCols; col++)
+
+
+    void ButtonMatrix::flushEvents()
+    //-----------------------------------------------------------------------------
+    {
+        if (m_numEvents > 0)
         {
-            m_ioItf.digitalWrite(m_colPins[col], HIGH);
-            m_ioItf.pinMode(m_colPins[col], INPUT);
+            // reset first, so the callback can not see a batch twice
+            const uint8_t numEvents = m_numEvents;
+            m_numEvents = 0;
+            if (NULL != m_batchCallback)
+            {
+                m_batchCallback(m_batchContext, m_pEvents, numEvents);
+            }
         }
+    }
 
-        return true;
+
+
+    void ButtonMatrix::dispatchSubscriptions(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        for (ButtonSubscription* pSub = m_pSubscriptions; NULL != pSub; pSub = pSub->m_pNext)
+        {
+            const uint8_t mask = pSub->m_eventMask;
+            if (0 != (mask & BTN_EVENT_FELL)) dispatch(*pSub, m_fellKeys, BTN_STATE_PRESSED, BTN_ACTION_NONE, now);
+            if (0 != (mask & BTN_EVENT_ROSE)) dispatch(*pSub, m_roseKeys, BTN_STATE_RELEASED, BTN_ACTION_NONE, now);
+        }
     }
 
 
 
-    bool ButtonMatrix::update()
+    void ButtonMatrix::dispatchAction(uint16_t idx, BTN_STATE state, BTN_ACTION action, unsigned long now)
     //-----------------------------------------------------------------------------
     {
-        bool hasAnyButtonChanged = false;
+        ButtonEvent evt;
+        evt.idx = idx;
+        evt.state = state;
+        evt.action = action;
+        evt.keyCode = (NULL != m_pKeymap) ? m_pKeymap->getKeyCode(idx) : (keycode_t)BTN_KEY_NONE;
+#if BTNMATRIX_EVENT_MICROS
+        evt.micros = getSampleMicros(idx, now);
+#else
+        (void)now;
+#endif
+        const uint8_t kind = evt.getKind();
 
-        // just scan if the minimum scan interval has elapsed
-        if (millis() - m_lastScan >= m_scanInterval)
+        // actions are rare, so they are passed on as they are detected
+        for (ButtonSubscription* pSub = m_pSubscriptions; NULL != pSub; pSub = pSub->m_pNext)
         {
-            // iterate through all columns
-            for (uint8_t col = 0; col < m_numCols; col++)
+            if (NULL != pSub->m_callback && 0 != (pSub->m_eventMask & kind) && pSub->hasKey(idx))
             {
-                // set pin mode for the current column pin to OUTPUT
-                m_ioItf.pinMode(m_colPins[col], OUTPUT);
-                // pull down the output pin
-                m_ioItf.digitalWrite(m_colPins[col], LOW);
-                // iterate through all rows
-                for (uint8_t row = 0; row < m_numRows; row++)
-                {
-                    auto pBut = getButton(row, col);
-                    if (NULL != pBut)
-                    {
-                        auto pBtnItf = static_cast<ButtonBaseItf*>(pBut);
-                        BTN_STATE state = (m_ioItf.digitalRead(m_rowPins[row]) == (m_invertInput ? HIGH : LOW))
-                                                ? BTN_STATE_PRESSED
-                                                : BTN_STATE_RELEASED;
-                        bool bChanged = pBtnItf->updateState(state);
-                        if (bChanged && NULL != m_buttonEventCallback)
-                        {
-                            // The state of the button has changed and a callback function is registered -> lets notify
-                            m_buttonEventCallback(*pBut);
-                        }
-                        if (NULL != m_buttonActionCallback)
-                        {
-                            if (bChanged && BTN_STATE_RELEASED == state && pBtnItf->doNotifyClick())
-                            {
-                                // Button has been released -> send a click event
-                                pBtnItf->updateAction(BTN_ACTION_CLICK);
-                                m_buttonActionCallback(*pBut);
-                            }
-                            else if (pBut->isLongPressed(m_LongPressMS))
-                            {
-                                pBtnItf->updateAction(BTN_ACTION_LONG_PRESS);
-                                m_buttonActionCallback(*pBut);
-                            }
-                        }
-
-                        // we need to report back if any button has changed its state
-                        hasAnyButtonChanged = hasAnyButtonChanged || bChanged;
-                    }
-                }
-                // set column pin to HIGH and INPUT again
-                // necessary to allow detection of multiple buttons pressed in the
-                // same row and not causing a short in this situation
-                m_ioItf.digitalWrite(m_colPins[col], HIGH);
-                m_ioItf.pinMode(m_colPins[col], INPUT);
+                pSub->m_callback(pSub->m_context, evt);
             }
+        }
+    }
 
-            // lets remember our last scan timestamp
-            m_lastScan = millis();
+
+
+    void ButtonMatrix::dispatch(ButtonSubscription& sub, const KeySet& keys, BTN_STATE state, BTN_ACTION action, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        // cheap word compare first, most subscriptions won't match at all
+        if (NULL == sub.m_callback || (NULL != sub.m_pKeys && !keys.intersects(*sub.m_pKeys)))
+        {
+            return;
         }
 
-        return hasAnyButtonChanged;
+        ButtonEvent evt;
+        evt.state = state;
+        evt.action = action;
+        for (uint16_t idx = keys.findFirst(); KeySet::npos != idx; idx = keys.findNext(idx))
+        {
+            if (!sub.hasKey(idx))
+            {
+                continue;
+            }
+            evt.idx = idx;
+            evt.keyCode = (NULL != m_pKeymap) ? m_pKeymap->getKeyCode(idx) : (keycode_t)BTN_KEY_NONE;
+#if BTNMATRIX_EVENT_MICROS
+            evt.micros = getSampleMicros(idx, now);
+#endif
+            sub.m_callback(sub.m_context, evt);
+        }
+#if !BTNMATRIX_EVENT_MICROS
+        (void)now;
+#endif
+    }
+
+
+
+    void ButtonMatrix::setScanObserver(ScanObserverItf* pObserver)
+    //-----------------------------------------------------------------------------
+    {
+        m_pScanObserver = pObserver;
     }
 
 
@@ -158,7 +1270,7 @@ namespace RSys
     //-----------------------------------------------------------------------------
     {
         // make sure to only return a valid button inside the valid range
-        return ((idx < m_numButtons) ? &m_pButtons[idx] : NULL);
+        return ((idx < m_numButtons && NULL != m_pButtons) ? &m_pButtons[idx] : NULL);
     }
 
 
@@ -167,7 +1279,7 @@ namespace RSys
     {
         Button* pButton = NULL;
         // make sure to only return a valid button inside the valid range
-        if (m_numRows > row && m_numCols > col)
+        if (m_numRows > row && m_numCols > col && NULL != m_pButtons)
         {
             pButton = &m_pButtons[row * m_numCols + col];
         }
@@ -176,10 +1288,98 @@ namespace RSys
     }
 
 
+    ButtonView ButtonMatrix::getButtonView(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        // matrices without store hand out views onto an empty store always reporting released buttons
+        static CompactButtonStore emptyStore(0, NULL, NULL, NULL);
+        return ButtonView((NULL != m_pStore) ? *m_pStore : emptyStore, idx);
+    }
+
+
+    ButtonView ButtonMatrix::getButtonView(uint8_t row, uint8_t col) const
+    //-----------------------------------------------------------------------------
+    {
+        // positions out of range map to an index out of range
+        return getButtonView((m_numRows > row && m_numCols > col) ? (uint16_t)(row * m_numCols + col) : KeySet::npos);
+    }
+
+
+    void ButtonMatrix::setPopulatedKeys(const KeySet& populated)
+    //-----------------------------------------------------------------------------
+    {
+        ensureMemory();
+        m_populatedKeys = populated;
+        updateScanKeys();
+    }
+
+
+    void ButtonMatrix::setKeyPopulated(uint8_t row, uint8_t col, bool populated)
+    //-----------------------------------------------------------------------------
+    {
+        if (m_numRows > row && m_numCols > col && ensureMemory())
+        {
+            m_populatedKeys.set(row * m_numCols + col, populated);
+            updateScanKeys();
+        }
+    }
+
+
+    void ButtonMatrix::setPriorityKeys(const KeySet* pPriority, uint16_t interval)
+    //-----------------------------------------------------------------------------
+    {
+        m_pPriorityKeys = pPriority;
+        m_priorityInterval = interval;
+        updateScanKeys();
+    }
+
+
+    void ButtonMatrix::setButtonEnabled(uint16_t idx, bool bEnabled)
+    //-----------------------------------------------------------------------------
+    {
+        if (idx < m_numButtons)
+        {
+            if (NULL != m_pStore)
+            {
+                m_pStore->setEnabled(idx, bEnabled);
+            }
+            else
+            {
+                m_pButtons[idx].setEnabled(bEnabled);
+            }
+            ensureMemory();
+            m_enabledKeys.set(idx, bEnabled);
+            updateScanKeys();
+        }
+    }
+
+
     void ButtonMatrix::setMinLongPressDuration(uint16_t ms)
     //-----------------------------------------------------------------------------
     {
         m_LongPressMS = ms;
+
+        // the long presses of the buttons being held have to be determined again
+        m_deadline = m_clock.millis();
+        m_deadlinePending = true;
+    }
+
+
+    void ButtonMatrix::setAutoRepeat(const KeySet* pKeys, uint16_t delay, uint16_t rate)
+    //-----------------------------------------------------------------------------
+    {
+        m_pAutoRepeatKeys = pKeys;
+        m_repeatDelay = delay;
+        m_repeatRate = (0 < rate) ? rate : 1;
+        m_repeatIdx = KeySet::npos;
+    }
+
+
+    void ButtonMatrix::setRepeatTimings(const RepeatTiming* pTimings, uint8_t numTimings)
+    //-----------------------------------------------------------------------------
+    {
+        m_pRepeatTimings = pTimings;
+        m_numRepeatTimings = (NULL != pTimings) ? numTimings : 0;
     }
 
 
@@ -196,4 +1396,271 @@ namespace RSys
         m_buttonEventCallback = cb;
     }
 
+
+    void ButtonMatrix::registerButtonBatchCallback(btnBatchFnc cb, void* ctx)
+    //-----------------------------------------------------------------------------
+    {
+        m_batchCallback = cb;
+        m_batchContext = ctx;
+
+#ifndef BTNMATRIX_NO_HEAP
+        // the buffer is kept once allocated
+        if (NULL != cb && NULL == m_pEvents)
+        {
+            m_pEvents = new ButtonEvent[BTNMATRIX_MAX_BATCH_EVENTS];
+            m_maxEvents = (NULL != m_pEvents) ? BTNMATRIX_MAX_BATCH_EVENTS : 0;
+            m_numEvents = 0;
+            m_ownsEvents = true;
+        }
+#endif
+    }
+
+
+    void ButtonMatrix::registerButtonBatchCallback(btnBatchFnc cb, void* ctx, ButtonEvent* pEvents, uint8_t numEvents)
+    //-----------------------------------------------------------------------------
+    {
+#ifndef BTNMATRIX_NO_HEAP
+        if (m_ownsEvents)
+        {
+            delete [] m_pEvents;
+        }
+#endif
+        m_pEvents = pEvents;
+        m_maxEvents = (NULL != pEvents) ? numEvents : 0;
+        m_numEvents = 0;
+        m_ownsEvents = false;
+
+        m_batchCallback = cb;
+        m_batchContext = ctx;
+    }
+
+
+    void ButtonMatrix::subscribe(ButtonSubscription& subscription)
+    //-----------------------------------------------------------------------------
+    {
+        // make sure a subscription is never registered twice
+        unsubscribe(subscription);
+
+        subscription.m_pNext = m_pSubscriptions;
+        m_pSubscriptions = &subscription;
+        m_subscribedKinds |= subscription.m_eventMask;
+    }
+
+
+    void ButtonMatrix::unsubscribe(ButtonSubscription& subscription)
+    //-----------------------------------------------------------------------------
+    {
+        m_subscribedKinds = 0;
+        ButtonSubscription** ppSub = &m_pSubscriptions;
+        while (NULL != *ppSub)
+        {
+            if (*ppSub == &subscription)
+            {
+                *ppSub = subscription.m_pNext;
+                subscription.m_pNext = NULL;
+            }
+            else
+            {
+                m_subscribedKinds |= (*ppSub)->m_eventMask;
+                ppSub = &(*ppSub)->m_pNext;
+            }
+        }
+    }
+
+
+
+    void ButtonMatrix::addChord(ButtonChord& chord)
+    //-----------------------------------------------------------------------------
+    {
+        // make sure a chord is never registered twice
+        removeChord(chord);
+        if (NULL == chord.m_callback)
+        {
+            return;
+        }
+
+        chord.m_active = false;
+        chord.m_touched = false;
+        chord.m_pNext = m_pChords;
+        m_pChords = &chord;
+    }
+
+
+
+    void ButtonMatrix::removeChord(ButtonChord& chord)
+    //-----------------------------------------------------------------------------
+    {
+        ButtonChord** ppChord = &m_pChords;
+        while (NULL != *ppChord)
+        {
+            if (*ppChord == &chord)
+            {
+                *ppChord = chord.m_pNext;
+                chord.m_pNext = NULL;
+            }
+            else
+            {
+                ppChord = &(*ppChord)->m_pNext;
+            }
+        }
+    }
+
+
+
+    void ButtonMatrix::updateRepeat(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        m_repeated = false;
+
+        // the button pressed last takes over the repetition
+        uint16_t idx = KeySet::npos;
+        if (NULL != m_pAutoRepeatKeys)
+        {
+            for (idx = m_fellKeys.findFirst(); KeySet::npos != idx && !m_pAutoRepeatKeys->test(idx); idx = m_fellKeys.findNext(idx))
+            {
+            }
+        }
+
+        if (KeySet::npos != idx)
+        {
+            uint16_t delay = m_repeatDelay;
+            m_curRepeatRate = m_repeatRate;
+            for (uint8_t timing = 0; timing < m_numRepeatTimings; timing++)
+            {
+                if (idx == m_pRepeatTimings[timing].idx)
+                {
+                    delay = m_pRepeatTimings[timing].delay;
+                    m_curRepeatRate = (0 < m_pRepeatTimings[timing].rate) ? m_pRepeatTimings[timing].rate : 1;
+                    break;
+                }
+            }
+
+            m_repeatIdx = idx;
+            m_repeatDue = now + delay;
+            m_repeating = false;
+        }
+        else if (KeySet::npos != m_repeatIdx && m_pressedKeys.test(m_repeatIdx) && (long)(now - m_repeatDue) >= 0)
+        {
+            m_repeated = true;
+            m_repeating = true;
+
+            // skip the repeats missed (i.e. update() has not been called in time)
+            m_repeatDue += m_curRepeatRate;
+            if ((long)(now - m_repeatDue) >= 0)
+            {
+                m_repeatDue = now + m_curRepeatRate;
+            }
+        }
+    }
+
+
+
+    void ButtonMatrix::processChords(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        // disabled buttons neither complete nor reject a chord
+        KeySet& pressed = m_scratchKeys;
+        pressed = m_pressedKeys;
+        pressed &= m_enabledKeys;
+
+        for (ButtonChord* pChord = m_pChords; NULL != pChord; pChord = pChord->m_pNext)
+        {
+            ButtonChord& chord = *pChord;
+            if (NULL == chord.m_callback)
+            {
+                continue;
+            }
+
+            if (!pressed.intersects(chord.m_keys))
+            {
+                // all buttons of the chord released -> ready for the next attempt
+                chord.m_touched = false;
+                if (chord.m_active)
+                {
+                    chord.m_active = false;
+                    chord.m_callback(chord.m_context, chord, BTN_STATE_RELEASED);
+                }
+                continue;
+            }
+
+            if (!chord.m_touched)
+            {
+                chord.m_touched = true;
+                chord.m_firstPress = now;
+            }
+
+            if (chord.m_active)
+            {
+                if (!pressed.contains(chord.m_keys))
+                {
+                    chord.m_active = false;
+                    chord.m_callback(chord.m_context, chord, BTN_STATE_RELEASED);
+                }
+            }
+            else if (m_fellKeys.intersects(chord.m_keys)
+                     && pressed.contains(chord.m_keys)
+                     && (0 == chord.m_window || now - chord.m_firstPress <= chord.m_window))
+            {
+                // exclusive chords just match if no other button is pressed
+                if (!chord.m_exclusive || chord.m_keys.contains(pressed))
+                {
+                    chord.m_active = true;
+                    chord.m_callback(chord.m_context, chord, BTN_STATE_PRESSED);
+                }
+            }
+        }
+    }
+
+
+
+#if BTNMATRIX_EVENT_MICROS
+    void ButtonMatrix::setVelocityPairs(VelocityPair* pPairs, uint8_t numPairs)
+    //-----------------------------------------------------------------------------
+    {
+        m_pVelocityPairs = pPairs;
+        m_numVelocityPairs = (NULL != pPairs) ? numPairs : 0;
+
+        for (uint8_t idx = 0; idx < m_numVelocityPairs; idx++)
+        {
+            m_pVelocityPairs[idx].earlyMicros = 0;
+            m_pVelocityPairs[idx].armed = false;
+        }
+    }
+
+
+
+    void ButtonMatrix::setVelocityRange(unsigned long minMicros, unsigned long maxMicros)
+    //-----------------------------------------------------------------------------
+    {
+        m_velocityMinMicros = minMicros;
+        m_velocityMaxMicros = (maxMicros > minMicros) ? maxMicros : minMicros + 1;
+    }
+
+
+
+    void ButtonMatrix::registerVelocityCallback(velocityFnc cb, void* ctx)
+    //-----------------------------------------------------------------------------
+    {
+        m_velocityCallback = cb;
+        m_velocityContext = ctx;
+    }
+
+
+
+    unsigned long ButtonMatrix::getVelocityResolution() const
+    //-----------------------------------------------------------------------------
+    {
+        // the pairs are scanned at the priority interval only if all of their buttons are priority buttons
+        bool priority = 0 < m_numVelocityPairs && m_priorityLines.any() && m_priorityInterval < m_scanInterval;
+        for (uint8_t idx = 0; priority && idx < m_numVelocityPairs; idx++)
+        {
+            priority = NULL != m_pPriorityKeys
+                       && m_pPriorityKeys->test(m_pVelocityPairs[idx].early) && m_pPriorityKeys->test(m_pVelocityPairs[idx].late);
+        }
+
+        const unsigned long period = (priority ? m_priorityInterval : m_scanInterval) * 1000UL;
+        return (period > m_scanMicros) ? period : m_scanMicros;
+    }
+#endif
+
 }
@@ -29,11 +29,64 @@
 
 #include "Button.h"
 #include "NativeIOHandler.h"
+#include "AsyncIOHandlerItf.h"
+#include "NativeClock.h"
+#include "KeySet.h"
+#include "CompactButtonStore.h"
+#include "ButtonEvent.h"
+#include "ButtonChord.h"
+#include "ScanObserverItf.h"
 
 
 
 namespace RSys
 {
+    /**
+        @brief Lines driven by the scan (the other lines are read)
+    */
+    enum SCAN_ORIENTATION : unsigned char
+    {
+        SCAN_DRIVE_COLS = 0,    /** Drive the columns and read the rows (default) */
+        SCAN_DRIVE_ROWS = 1,    /** Drive the rows and read the columns */
+        SCAN_AUTO       = 2     /** Drive the dimension with fewer lines to be scanned */
+    };
+
+    /**
+        @brief Direction of the diodes in the matrix (the current flows from the read line into the driven line)
+    */
+    enum DIODE_DIRECTION : unsigned char
+    {
+        DIODES_NONE     = 0,    /** No diodes, the matrix can be scanned in both orientations */
+        DIODES_ROW2COL  = 1,    /** Cathodes towards the columns, the columns must be driven */
+        DIODES_COL2ROW  = 2     /** Cathodes towards the rows, the rows must be driven */
+    };
+
+    /**
+        @brief Electrical handling of the drive lines during the scan
+    */
+    enum DRIVE_MODE : unsigned char
+    {
+        DRIVE_TRISTATE  = 0,    /** Idle drive lines are switched to INPUT (safe for every matrix, default) */
+        DRIVE_PUSH_PULL = 1     /** Drive lines stay OUTPUT and only the level changes
+                                    (requires diodes or open-drain outputs, otherwise pressing two buttons
+                                    of the same read line shorts a HIGH and a LOW output) */
+    };
+
+
+    /**
+        @brief Auto-repeat timing of a particular button (overrides the global timing)
+    */
+    struct RepeatTiming
+    {
+        uint16_t    idx;    /** Index of the button */
+        uint16_t    delay;  /** Time in ms from pressing the button until the first repeat */
+        uint16_t    rate;   /** Time in ms between subsequent repeats */
+    };
+
+
+    template <uint8_t Rows, uint8_t Cols> struct MatrixMemory;
+
+
     /**
         @brief Provides a simple interface for using a button matrix with Arduino
                (similar to KeyMap but with more flexibility and a more object oriented approach)
@@ -51,6 +104,28 @@ namespace RSys
         */
         typedef void (*btnEventFnc)(Button&);
 
+        /**
+            @brief  Batched button event callback type
+            @param  void*
+                    Context pointer given on registration
+            @param  const ButtonEvent*
+                    Array of the events of one scan
+            @param  uint8_t
+                    Number of events in the array
+        */
+        typedef void (*btnBatchFnc)(void*, const ButtonEvent*, uint8_t);
+
+#if BTNMATRIX_EVENT_MICROS
+        /**
+            @brief  Velocity callback type
+            @param  void*
+                    Context pointer given on registration
+            @param  const VelocityEvent&
+                    The measured key press
+        */
+        typedef void (*velocityFnc)(void*, const VelocityEvent&);
+#endif
+
         /**
             @brief  c'tor
             @param  buttons
@@ -67,11 +142,80 @@ namespace RSys
                     (the number of elements in the colPins array must be adequate)
             @param  ioItf
                     Reference to the IO handler implementation to be used
+            @param  clock
+                    Reference to the time source to be used
+                    (sampled once per scan, defaults to millis())
         */
         ButtonMatrix(
-                Button* buttons, uint8_t* rowPins, uint8_t* colPins,
+                Button* buttons, pin_t* rowPins, pin_t* colPins,
                 uint8_t numRows, uint8_t numCols,
-                IOHandlerItf& ioItf = NativeIOHandler::getDefault());
+                IOHandlerItf& ioItf = NativeIOHandler::getDefault(),
+                ClockItf& clock = NativeClock::getDefault());
+
+        /**
+            @brief  c'tor for matrices keeping their button state in a CompactButtonStore
+                    instead of Button objects (use getButtonView() to query the buttons).
+                    The button state and action callbacks are not supported in this mode
+            @param  store
+                    Reference to the button state store of size numRows * numCols
+            @param  rowPins
+                    Pointer to the one dimensional array of row pins of size numRows
+            @param  colPins
+                    Pointer to the one dimensional array of column pins of size numCols
+            @param  numRows
+                    Number of rows the button matrix has
+            @param  numCols
+                    Number of columns the button matrix has
+            @param  ioItf
+                    Reference to the IO handler implementation to be used
+            @param  clock
+                    Reference to the time source to be used
+        */
+        ButtonMatrix(
+                CompactButtonStore& store, pin_t* rowPins, pin_t* colPins,
+                uint8_t numRows, uint8_t numCols,
+                IOHandlerItf& ioItf = NativeIOHandler::getDefault(),
+                ClockItf& clock = NativeClock::getDefault());
+
+        /**
+            @brief  d'tor
+        */
+        ~ButtonMatrix();
+
+        /**
+            @brief  Gets the number of words of the memory a matrix needs
+                    (key bitmaps, drive line bitmaps and bulk read buffers, see MatrixMemory)
+            @param  numRows
+                    Number of rows of the matrix
+            @param  numCols
+                    Number of columns of the matrix
+            @return Number of words
+        */
+        static constexpr uint16_t getMemoryWords(uint8_t numRows, uint8_t numCols)
+        {
+            return s_numKeySets * KeySet::wordsFor(numRows * numCols)
+                   + s_numLineSets * KeySet::wordsFor((numRows > numCols) ? numRows : numCols)
+                   + KeySet::wordsFor(2 * 8 * ((((numRows > numCols) ? numRows : numCols) + 7) / 8));
+        }
+
+        /**
+            @brief  Sets the memory of the matrix (call it before init(), the settings made so far are kept).
+                    Without it the matrix allocates its memory on the heap the first time it is needed
+                    (init() fails if BTNMATRIX_NO_HEAP is defined)
+            @param  memory
+                    Memory of the size of the matrix (declare it as static object)
+            @return True if succeeded (false if the memory is smaller than the matrix)
+        */
+        template <uint8_t Rows, uint8_t Cols>
+        bool setMemory(MatrixMemory<Rows, Cols>& memory)
+        {
+#if BTNMATRIX_EVENT_MICROS
+            return adoptMemory(memory.words, sizeof(memory.words) / sizeof(KeySet::word_t),
+                               memory.lineMicros, sizeof(memory.lineMicros) / sizeof(unsigned long));
+#else
+            return adoptMemory(memory.words, sizeof(memory.words) / sizeof(KeySet::word_t), NULL, 0);
+#endif
+        }
 
         /**
             @brief  Gets the current scan interval
@@ -97,14 +241,87 @@ namespace RSys
         */
         void setInvertInput(bool invertInput = true);
 
+        /**
+            @brief  Sets the scan orientation (call before init()).
+                    SCAN_AUTO drives the dimension with fewer lines to be scanned,
+                    so i.e. a 2x16 keypad needs 2 instead of 16 drive cycles
+            @param  orientation
+                    Lines to be driven
+            @param  diodes
+                    Direction of the diodes, restricts the orientation if not DIODES_NONE
+        */
+        void setScanOrientation(SCAN_ORIENTATION orientation, DIODE_DIRECTION diodes = DIODES_NONE);
+
+        /**
+            @brief  Sets the drive mode (call before init()).
+                    DRIVE_PUSH_PULL saves both pinMode() calls per drive line and scan
+                    (on I2C expanders each of them is a register read-modify-write)
+            @param  mode
+                    Drive mode
+        */
+        inline void setDriveMode(DRIVE_MODE mode) { m_driveMode = mode; }
+
+        /**
+            @brief  Gets the drive mode
+            @return Drive mode
+        */
+        inline DRIVE_MODE getDriveMode() const { return m_driveMode; }
+
+        /**
+            @brief  Sets the time to wait between driving a line and reading the other lines
+                    (for long cables or high line capacitance)
+            @param  us
+                    Settle time in microseconds (0 by default)
+        */
+        inline void setSettleTime(uint16_t us) { m_settleTime = us; }
+
+        /**
+            @brief  Gets the settle time
+            @return Settle time in microseconds
+        */
+        inline uint16_t getSettleTime() const { return m_settleTime; }
+
+        /**
+            @brief  Determines the shortest settle time without ghost keys and uses it for the
+                    following scans. A read line pulled LOW by a closed key recovers slowly
+                    (i.e. on long cables), so it may still read LOW while the next line is driven.
+                    The calibration therefore needs a known stimulus: the reference button has
+                    to be closed during the calibration (held or a hard-wired loopback position)
+                    and all other buttons open. Call it after init() (i.e. in setup())
+            @param  refKey
+                    Index of the reference button (must not be on the last drive line scanned,
+                    otherwise there is no following line to show the ghost)
+            @param  maxUs
+                    Maximum settle time in microseconds
+            @param  repeats
+                    Number of scans each settle time must read correctly
+            @return Settle time determined in microseconds (the settle time is not changed
+                    if even maxUs does not read the reference button alone)
+        */
+        uint16_t calibrateSettleTime(uint16_t refKey, uint16_t maxUs = 100, uint8_t repeats = 4);
+
+        /**
+            @brief  Gets the effective scan orientation (resolved by init() in case of SCAN_AUTO)
+            @return SCAN_DRIVE_COLS or SCAN_DRIVE_ROWS
+        */
+        inline SCAN_ORIENTATION getScanOrientation() const { return m_driveRows ? SCAN_DRIVE_ROWS : SCAN_DRIVE_COLS; }
+
 
         /**
             @brief  Initializes the button matrix
                     (make sure to call init() once in the Arduinos setup() function!)
             @return True if succeeded
+                    (false if there is no memory for the matrix, the store is too small or the IO handler is not valid)
         */
         bool init();
 
+        /**
+            @brief  Configures the pins again without touching the button states
+                    (i.e. to recover from a reset of an IO expander, the state cached
+                    by the IO handler is dropped, see IOHandlerItf::invalidate())
+        */
+        void reinit();
+
         /**
             @brief  Call update() to update the button matrix state.
                     Should be called each time the Arduinos loop() function is executed
@@ -113,6 +330,145 @@ namespace RSys
         */
         bool update();
 
+        /**
+            @brief  Gets the time until update() needs to be called again, so the caller
+                    can sleep or yield instead of polling (the next (priority) scan or the next long press
+                    of a pressed button, whatever is due first; long presses due between two
+                    scans are processed by update() without any IO)
+            @return Time in ms (0 if update() is due)
+        */
+        unsigned long getTimeToNextUpdate() const;
+
+        /**
+            @brief  Checks whether an asynchronous scan is in progress
+                    (just possible with an AsyncIOHandlerItf, update() then continues the scan
+                    as far as the transfers have completed and never waits for the bus)
+            @return True if a scan is in progress
+        */
+        inline bool isScanBusy() const { return ASYNC_IDLE != m_asyncStep; }
+
+        /**
+            @brief  Updates the buttons from a raw scan result without performing any IO.
+                    Used by update() and to replay recorded scans (see ScanTraceReplayer)
+            @param  raw
+                    Raw key bitmap, a set bit means the button is pressed
+            @param  now
+                    Timestamp in ms of the scan
+            @return True if the state of any button in the matrix has changed
+        */
+        bool processScan(const KeySet& raw, unsigned long now);
+
+        /**
+            @brief  Defines which matrix positions are equipped with a switch.
+                    Only populated and enabled positions are scanned, columns without
+                    any of them are not driven at all (all positions are populated by default)
+            @param  populated
+                    Set of the populated button indices
+        */
+        void setPopulatedKeys(const KeySet& populated);
+
+        /**
+            @brief  Defines whether or not a single matrix position is equipped with a switch
+            @param  row
+                    Button row (0..numRows-1)
+            @param  col
+                    Button column (0..numCols-1)
+            @param  populated
+                    False, if there is no switch at the position
+        */
+        void setKeyPopulated(uint8_t row, uint8_t col, bool populated = true);
+
+        /**
+            @brief  (Re)sets the enabled state of a button and excludes disabled buttons from the scan.
+                    Prefer this over Button::setEnabled() (which just hides the state) for buttons
+                    that stay disabled for a longer time
+            @param  idx
+                    Index of the button
+            @param  bEnabled
+                    True for enabled
+        */
+        void setButtonEnabled(uint16_t idx, bool bEnabled);
+
+        /**
+            @brief  Defines buttons to be scanned at a higher rate than the scan interval.
+                    Between the regular scans update() just scans the lines of these
+                    buttons (all buttons sharing a drive line with them are scanned as well)
+            @param  pPriority
+                    Set of the priority button indices (declare it as static object, the set is
+                    not copied, call the function again after changing it; NULL to disable)
+            @param  interval
+                    Scan interval of the priority buttons in ms (0 to scan them on each update())
+        */
+        void setPriorityKeys(const KeySet* pPriority, uint16_t interval = 0);
+
+        /**
+            @brief  Gets the buttons that are scanned (populated and enabled)
+            @param  keys
+                    Reference to the set receiving the button indices
+        */
+        void getScannedKeys(KeySet& keys) const;
+
+        /**
+            @brief  Gets the buttons whose state has changed during the last call of update()
+                    (disabled buttons are never part of the set). Iterate them by means of
+                    KeySet::findFirst() / KeySet::findNext() instead of polling every button
+            @return Reference to the set of button indices
+        */
+        inline const KeySet& getChangedKeys() const { return m_changedKeys; }
+
+        /**
+            @brief  Gets the buttons that have been pressed during the last call of update()
+            @return Reference to the set of button indices
+        */
+        inline const KeySet& getFellKeys() const { return m_fellKeys; }
+
+        /**
+            @brief  Gets the buttons that have been released during the last call of update()
+                    (regardless of whether or not the rose event of the button is swallowed)
+            @return Reference to the set of button indices
+        */
+        inline const KeySet& getRoseKeys() const { return m_roseKeys; }
+
+        /**
+            @brief  Gets the buttons that are currently pressed
+                    (as of the last scan, regardless of their enabled state)
+            @return Reference to the set of button indices
+        */
+        inline const KeySet& getPressedKeys() const { return m_pressedKeys; }
+
+        /**
+            @brief  Gets the buttons that are enabled (see setButtonEnabled())
+            @return Reference to the set of button indices
+        */
+        inline const KeySet& getEnabledKeys() const { return m_enabledKeys; }
+
+        /**
+            @brief  Determines whether or not any button has been pressed during the last call of update()
+            @return True, if at least one button fell
+        */
+        inline bool anyFell() const { return m_fellKeys.any(); }
+
+        /**
+            @brief  Determines whether or not any button has been released during the last call of update()
+            @return True, if at least one button rose
+        */
+        inline bool anyRose() const { return m_roseKeys.any(); }
+
+        /**
+            @brief  Gets the button that has been repeated during the last call of update()
+                    (just a single button is repeated at a time)
+            @return Index of the button or KeySet::npos if none
+        */
+        inline uint16_t getRepeatedKey() const { return m_repeated ? m_repeatIdx : KeySet::npos; }
+
+        /**
+            @brief  Sets an observer getting each raw scan result before it is processed
+                    (i.e. a ScanTraceRecorder)
+            @param  pObserver
+                    Pointer to the observer or NULL to remove it
+        */
+        void setScanObserver(ScanObserverItf* pObserver);
+
         /**
             @brief  Gets the button object with the given index into the matrix
             @param  idx
@@ -133,6 +489,26 @@ namespace RSys
         */
         Button* getButton(uint8_t row, uint8_t col);
 
+        /**
+            @brief  Gets a view onto the button with the given index
+                    (only available for matrices using a CompactButtonStore)
+            @param  idx
+                    Index into the matrix (staring with 0 and limited by numRows * numCols - 1)
+            @return View onto the button (queries on views out of range report a released button)
+        */
+        ButtonView getButtonView(uint16_t idx) const;
+
+        /**
+            @brief  Gets a view onto the button at the given matrix position
+                    (only available for matrices using a CompactButtonStore)
+            @param  row
+                    Button row (0..numRows-1)
+            @param  col
+                    Button column (0..numCols-1)
+            @return View onto the button
+        */
+        ButtonView getButtonView(uint8_t row, uint8_t col) const;
+
         /**
             @brief  Gets the number of buttons in the matrix
             @return Number of buttons
@@ -151,6 +527,12 @@ namespace RSys
         */
         inline uint8_t getNumCols() const { return m_numCols; }
 
+        /**
+            @brief  Gets the time source used by the matrix
+            @return Reference to the clock
+        */
+        inline ClockItf& getClock() const { return m_clock; }
+
         /**
             @brief  Gets minimum duration in ms after which a long press is detected
             @return Duration in ms
@@ -164,6 +546,29 @@ namespace RSys
         */
         void setMinLongPressDuration(uint16_t ms);
 
+        /**
+            @brief  Enables the typematic auto-repeat. The button pressed last out of the given
+                    buttons is repeated (BTN_ACTION_REPEAT) as long as it is held. The repeats are
+                    scheduled as deadline, so held buttons do not cost anything between the repeats
+            @param  pKeys
+                    Buttons to be repeated (declare the set as static object, it is not copied;
+                    NULL disables the auto-repeat)
+            @param  delay
+                    Time in ms from pressing a button until the first repeat
+            @param  rate
+                    Time in ms between subsequent repeats
+        */
+        void setAutoRepeat(const KeySet* pKeys, uint16_t delay = 500, uint16_t rate = 100);
+
+        /**
+            @brief  Sets button specific auto-repeat timings (looked up once per button press)
+            @param  pTimings
+                    Array of timings (declare it as static array, NULL for global timings only)
+            @param  numTimings
+                    Number of timings in the array
+        */
+        void setRepeatTimings(const RepeatTiming* pTimings, uint8_t numTimings);
+
         /**
             @brief  Register a callback function to get notified when a button activity has been performed
                     Please note: Only one callback can be registered. Subsequent calls will overwrite functions
@@ -182,15 +587,395 @@ namespace RSys
         */
         void registerButtonStateEventCallback(btnEventFnc cb);
 
+        /**
+            @brief  Register a callback function receiving all state changes and actions of a scan
+                    in a single call (also available for matrices using a CompactButtonStore).
+                    The events are buffered in BTNMATRIX_MAX_BATCH_EVENTS events allocated on the heap
+                    by the first registration (with BTNMATRIX_NO_HEAP each event is delivered on its own).
+                    If more events occur, the callback is called several times during the scan.
+                    Please note: Only one callback can be registered. Subsequent calls will overwrite functions
+                    previously set!
+            @param  cb
+                    Callback function
+            @param  ctx
+                    Context pointer handed to the callback
+        */
+        void registerButtonBatchCallback(btnBatchFnc cb, void* ctx = NULL);
+
+        /**
+            @brief  Register a callback function receiving all state changes and actions of a scan
+                    buffered in caller provided events (see above)
+            @param  cb
+                    Callback function
+            @param  ctx
+                    Context pointer handed to the callback
+            @param  pEvents
+                    Array of events (declare it as static array)
+            @param  numEvents
+                    Number of events in the array
+        */
+        void registerButtonBatchCallback(btnBatchFnc cb, void* ctx, ButtonEvent* pEvents, uint8_t numEvents);
+
+        /**
+            @brief  Registers a subscription. Any number of subscriptions can be registered.
+                    Events are filtered by the buttons and event kinds of the subscription
+                    on the packed bitmaps before any callback is called
+            @param  subscription
+                    Subscription (must stay valid until it is unsubscribed)
+        */
+        void subscribe(ButtonSubscription& subscription);
+
+        /**
+            @brief  Removes a subscription previously registered
+            @param  subscription
+                    Subscription to remove
+        */
+        void unsubscribe(ButtonSubscription& subscription);
+
+        /**
+            @brief  Registers a chord. Any number of chords can be registered. They are matched
+                    against the packed pressed-state bitmap of the enabled buttons whenever
+                    a button has changed (chords without callback are not registered)
+            @param  chord
+                    Chord (must stay valid until it is removed)
+        */
+        void addChord(ButtonChord& chord);
+
+        /**
+            @brief  Removes a chord previously registered
+            @param  chord
+                    Chord to remove
+        */
+        void removeChord(ButtonChord& chord);
+
+        /**
+            @brief  Sets the keymap resolving the key codes reported in the events
+                    (ButtonEvent::keyCode)
+            @param  pKeymap
+                    Keymap (declare it as static object, NULL to remove the keymap)
+        */
+        inline void setKeymap(Keymap* pKeymap) { m_pKeymap = pKeymap; }
+
+        /**
+            @brief  Gets the keymap
+            @return Pointer to the keymap (NULL if none has been set)
+        */
+        inline Keymap* getKeymap() const { return m_pKeymap; }
+
+#if BTNMATRIX_EVENT_MICROS
+        /**
+            @brief  Sets the dual-contact keys measured in velocity mode
+            @param  pPairs
+                    Array of pairs (declare it as static array, NULL to disable the velocity mode)
+            @param  numPairs
+                    Number of pairs in the array
+        */
+        void setVelocityPairs(VelocityPair* pPairs, uint8_t numPairs);
+
+        /**
+            @brief  Sets the travel times mapped linearly onto the velocities 127 ... 1
+                    (default is 1000 us ... 40000 us)
+            @param  minMicros
+                    Travel time (and below) reported as velocity 127
+            @param  maxMicros
+                    Travel time (and above) reported as velocity 1
+        */
+        void setVelocityRange(unsigned long minMicros, unsigned long maxMicros);
+
+        /**
+            @brief  Register a callback function receiving each key press measured by a velocity pair
+            @param  cb
+                    Callback function (NULL to unregister)
+            @param  ctx
+                    Context pointer handed to the callback
+        */
+        void registerVelocityCallback(velocityFnc cb, void* ctx = NULL);
+
+        /**
+            @brief  Gets the resolution of the measured travel times. Each contact is sampled once per
+                    scan of its line, so the resolution is the scan period of the pairs
+                    (the priority interval if all pairs are priority buttons), but not shorter
+                    than a full scan takes on the actual IO handler
+            @return Resolution in us
+        */
+        unsigned long getVelocityResolution() const;
+
+        /**
+            @brief  Gets the time the last full scan took (from starting the first line
+                    until the last line has been read)
+            @return Duration in us
+        */
+        inline unsigned long getScanDuration() const { return m_scanMicros; }
+#endif
+
 
     private:
 
-        Button*         m_pButtons;     /** Pointer to button array */
-        const uint8_t*  m_rowPins;      /** Array of row pins */
-        const uint8_t*  m_colPins;      /** Array of column pins */
+        /**
+            @brief  Steps of the asynchronous scan of a drive line
+        */
+        enum ASYNC_STEP : unsigned char
+        {
+            ASYNC_IDLE,         /** No scan in progress */
+            ASYNC_DRIVE,        /** Start driving the line and reading */
+            ASYNC_READ,         /** Wait for the read to complete */
+            ASYNC_RELEASE,      /** Start releasing the line */
+            ASYNC_RELEASING     /** Wait for the release to complete */
+        };
+
+        static const uint8_t s_numKeySets = 7;      /** Key bitmaps within the memory of a matrix */
+        static const uint8_t s_numLineSets = 2;     /** Drive line bitmaps within the memory of a matrix */
+
+        /**
+            @brief  Sets the memory of the matrix (see setMemory())
+            @param  pWords
+                    Words holding the bitmaps and the read buffers
+            @param  numWords
+                    Number of words
+            @param  pLineMicros
+                    Array of the sample times of the drive lines (BTNMATRIX_EVENT_MICROS only)
+            @param  numLineMicros
+                    Number of sample times in the array
+            @return True if succeeded
+        */
+        bool adoptMemory(KeySet::word_t* pWords, uint16_t numWords, unsigned long* pLineMicros, uint8_t numLineMicros);
+
+        /**
+            @brief  Allocates the memory of the matrix on the heap if there is none yet
+            @return True if the matrix has memory
+        */
+        bool ensureMemory();
+
+        /**
+            @brief  Releases the memory allocated by ensureMemory()
+        */
+        void releaseMemory();
+
+        /**
+            @brief  Gets the number of lines of the larger dimension of the matrix
+            @return Number of lines
+        */
+        inline uint8_t getMaxLines() const { return (m_numRows > m_numCols) ? m_numRows : m_numCols; }
+
+        /**
+            @brief  Starts a scan (completed immediately without an asynchronous IO handler)
+            @param  priority
+                    True to scan the priority lines only
+            @param  now
+                    Timestamp of the scan
+            @return True if the state of any button has changed
+        */
+        bool startScan(bool priority, unsigned long now);
+
+        /**
+            @brief  Notifies the scan observer and processes the scanned raw state
+            @param  priority
+                    True if the priority lines have been scanned only
+            @param  now
+                    Timestamp of the scan
+            @return True if the state of any button has changed
+        */
+        bool completeScan(bool priority, unsigned long now);
+
+        /**
+            @brief  Advances the asynchronous scan as far as the transfers have completed
+            @return True if the scan has completed
+        */
+        bool advanceAsyncScan();
+
+        /**
+            @brief  Builds the read mask of the populated and enabled positions of a drive line
+            @param  line
+                    Drive line
+            @param  mask
+                    Packed bits receiving the mask (one for each read line)
+        */
+        void buildReadMask(uint16_t line, uint8_t* mask) const;
+
+        /**
+            @brief  Takes the read levels of a drive line over into the raw key bitmap
+            @param  raw
+                    Raw key bitmap
+            @param  line
+                    Drive line
+            @param  mask
+                    Read mask of the line
+            @param  bits
+                    Read levels (set for HIGH)
+        */
+        void mergeReadBits(KeySet& raw, uint16_t line, const uint8_t* mask, const uint8_t* bits) const;
+
+        /**
+            @brief  Drives the drive lines and reads the read lines of the matrix
+            @param  raw
+                    Reference to the key bitmap receiving the pressed keys
+                    (just the bits of the lines scanned are updated)
+            @param  lines
+                    Drive lines to be scanned
+            @param  settleUs
+                    Time between driving and reading in microseconds
+        */
+        void scan(KeySet& raw, const KeySet& lines, uint16_t settleUs);
+
+        /**
+            @brief  Processes the long presses and repeats due at the deadline
+                    without processing the last scan again (no IO, no state changes)
+            @param  now
+                    Timestamp in ms
+        */
+        void processDeadline(unsigned long now);
+
+        /**
+            @brief  Determines whether or not anybody is interested in the actions of the buttons
+            @return True if the actions have to be determined
+        */
+        bool hasActionObservers() const;
+
+        /**
+            @brief  Determines and notifies the actions of a set of buttons
+            @param  candidates
+                    Buttons possibly having an action
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void processActions(const KeySet& candidates, unsigned long now);
+
+        /**
+            @brief  Determines the action of a button during a scan (see Button)
+            @param  idx
+                    Index of the button
+            @param  state
+                    State of the button
+            @param  now
+                    Timestamp in ms of the scan
+            @return Action detected or BTN_ACTION_NONE
+        */
+        BTN_ACTION detectAction(uint16_t idx, BTN_STATE state, unsigned long now);
+
+        /**
+            @brief  Recalculates the scanned buttons and columns after the population
+                    or the enabled state has changed
+        */
+        void updateScanKeys();
+
+        /**
+            @brief  Resolves the lines to be driven from the configured orientation and diode direction
+        */
+        void resolveOrientation();
+
+        /**
+            @brief  Determines the next long press deadline of the pressed buttons
+            @param  now
+                    Timestamp of the processed scan
+        */
+        void updateDeadline(unsigned long now);
+
+        /**
+            @brief  Configures the read and drive pins by means of the bulk operations of the IO handler
+        */
+        void configurePins();
+
+        /**
+            @brief  Adds an event to the batch (delivering the batch if it is full)
+            @param  idx
+                    Index of the button
+            @param  state
+                    State of the button
+            @param  action
+                    Action detected
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void pushEvent(uint16_t idx, BTN_STATE state, BTN_ACTION action, unsigned long now);
+
+        /**
+            @brief  Gets the time a button has been sampled during the scan being processed
+            @param  idx
+                    Index of the button
+            @param  now
+                    Timestamp in ms of the scan (used if there are no line timestamps)
+            @return Timestamp in us
+        */
+        unsigned long getSampleMicros(uint16_t idx, unsigned long now) const;
+
+        /**
+            @brief  Takes the timestamp of a drive line that has just been sampled
+                    (BTNMATRIX_EVENT_MICROS only)
+            @param  line
+                    Drive line
+        */
+        void sampleLineMicros(uint16_t line);
+
+        /**
+            @brief  Measures the key presses of the velocity pairs (BTNMATRIX_EVENT_MICROS only)
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void processVelocity(unsigned long now);
+
+        /**
+            @brief  Delivers the buffered events to the batch callback
+        */
+        void flushEvents();
+
+        /**
+            @brief  Calls all subscriptions interested in the state changes of the last scan
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void dispatchSubscriptions(unsigned long now);
+
+        /**
+            @brief  Calls all subscriptions interested in an action of a button
+            @param  idx
+                    Index of the button
+            @param  state
+                    State of the button
+            @param  action
+                    Action detected
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void dispatchAction(uint16_t idx, BTN_STATE state, BTN_ACTION action, unsigned long now);
+
+        /**
+            @brief  Matches the registered chords against the buttons pressed during the last scan
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void processChords(unsigned long now);
+
+        /**
+            @brief  Starts the repetition of a newly pressed button or marks the repeating
+                    button as repeated if its repeat is due
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void updateRepeat(unsigned long now);
+
+        /**
+            @brief  Calls a subscription for all events of a particular kind
+            @param  sub
+                    Subscription
+            @param  keys
+                    Buttons the event occurred for
+            @param  state
+                    State reported in the event
+            @param  action
+                    Action reported in the event
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        void dispatch(ButtonSubscription& sub, const KeySet& keys, BTN_STATE state, BTN_ACTION action, unsigned long now);
+
+        Button*         m_pButtons;     /** Pointer to button array (NULL when using a store) */
+        CompactButtonStore* m_pStore;   /** Pointer to the compact button store (NULL when using buttons) */
+        const pin_t*    m_rowPins;      /** Array of row pins */
+        const pin_t*    m_colPins;      /** Array of column pins */
         const uint8_t   m_numRows;      /** Number of rows in the matrix */
         const uint8_t   m_numCols;      /** Number of columns in the matrix */
         IOHandlerItf&   m_ioItf;        /** IO handler interface to use for digital IO */
+        ClockItf&       m_clock;        /** Time source sampled once per scan */
 
         uint16_t        m_scanInterval; /** Scan interval in ms */
         unsigned long   m_lastScan;     /** Timestamp (millis) of the last scan */
@@ -201,12 +986,99 @@ namespace RSys
 
         bool m_invertInput;
 
+        SCAN_ORIENTATION m_orientation;     /** Configured scan orientation */
+        DIODE_DIRECTION  m_diodes;          /** Configured diode direction */
+        bool             m_driveRows;       /** True if the rows are driven and the columns are read */
+        DRIVE_MODE       m_driveMode;       /** Electrical handling of the drive lines */
+        uint16_t         m_settleTime;      /** Time between driving and reading in microseconds */
+
+        uint16_t        m_priorityInterval; /** Scan interval of the priority buttons in ms */
+        unsigned long   m_lastPriorityScan; /** Timestamp (millis) of the last priority scan */
+        AsyncIOHandlerItf* m_pAsyncIO;      /** Asynchronous interface of the IO handler (NULL if not supported) */
+        ASYNC_STEP      m_asyncStep;        /** Step of the asynchronous scan */
+        bool            m_asyncPriority;    /** Asynchronous scan of the priority lines */
+        uint16_t        m_asyncLine;        /** Drive line of the asynchronous scan */
+        unsigned long   m_asyncStart;       /** Timestamp (millis) the asynchronous scan has been started */
+#if BTNMATRIX_EVENT_MICROS
+        unsigned long*  m_pLineMicros;      /** Time in us each drive line has been sampled */
+        bool            m_lineMicrosValid;  /** The line timestamps belong to the scan being processed */
+        unsigned long   m_scanStartMicros;  /** Time in us the current scan has been started */
+        unsigned long   m_scanMicros;       /** Duration in us of the last full scan */
+        VelocityPair*   m_pVelocityPairs;   /** Array of velocity pairs (may be NULL) */
+        uint8_t         m_numVelocityPairs; /** Number of velocity pairs */
+        unsigned long   m_velocityMinMicros;    /** Travel time reported as velocity 127 */
+        unsigned long   m_velocityMaxMicros;    /** Travel time reported as velocity 1 */
+        velocityFnc     m_velocityCallback;     /** Velocity callback */
+        void*           m_velocityContext;      /** Context of the velocity callback */
+#endif
+        unsigned long   m_deadline;         /** Time of the next long press between the scans */
+        bool            m_deadlinePending;  /** True if m_deadline is valid */
+
+        KeySet::word_t* m_pMemory;          /** Words holding the bitmaps and the read buffers (NULL until set or allocated) */
+        bool            m_ownsMemory;       /** Memory has been allocated by ensureMemory() */
+        uint8_t*        m_pReadMask;        /** Read mask of the drive line being scanned */
+        uint8_t*        m_pReadBits;        /** Levels read on the drive line being scanned */
+        KeySet          m_populatedKeys;    /** Positions equipped with a switch */
+        KeySet          m_enabledKeys;      /** Buttons enabled by means of setButtonEnabled() */
+        KeySet          m_pressedKeys;      /** Buttons pressed as of the last scan */
+        KeySet          m_changedKeys;      /** Buttons changed during the last update */
+        KeySet          m_fellKeys;         /** Buttons pressed during the last update */
+        KeySet          m_roseKeys;         /** Buttons released during the last update */
+        KeySet          m_scratchKeys;      /** Raw state of the scan in progress, temporary set otherwise */
+        KeySet          m_scanLines;        /** Drive lines with at least one button to be scanned (populated and enabled) */
+        KeySet          m_priorityLines;    /** Drive lines with at least one priority button to be scanned */
+        const KeySet*   m_pPriorityKeys;    /** Buttons scanned at the priority interval (may be NULL) */
+        const KeySet*   m_pAutoRepeatKeys;  /** Buttons to be repeated while held (may be NULL) */
+        const RepeatTiming* m_pRepeatTimings;   /** Button specific auto-repeat timings (may be NULL) */
+        uint8_t         m_numRepeatTimings; /** Number of button specific auto-repeat timings */
+        uint16_t        m_repeatDelay;      /** Time in ms until the first repeat */
+        uint16_t        m_repeatRate;       /** Time in ms between subsequent repeats */
+        uint16_t        m_repeatIdx;        /** Button being repeated (KeySet::npos if none) */
+        uint16_t        m_curRepeatRate;    /** Repeat rate of the button being repeated */
+        unsigned long   m_repeatDue;        /** Time of the next repeat */
+        bool            m_repeating;        /** The button being repeated has been repeated at least once */
+        bool            m_repeated;         /** The button being repeated has been repeated during the last update */
+        ScanObserverItf* m_pScanObserver;   /** Observer of the raw scans (may be NULL) */
+
         btnEventFnc     m_buttonActionCallback; /** Button action callback */
         btnEventFnc     m_buttonEventCallback;  /** Button state changed callback */
+        btnBatchFnc     m_batchCallback;        /** Batched event callback */
+        void*           m_batchContext;         /** Context of the batched event callback */
+
+        ButtonEvent*    m_pEvents;              /** Events of the current scan (NULL to deliver each event on its own) */
+        uint8_t         m_maxEvents;            /** Number of events in the buffer */
+        uint8_t         m_numEvents;            /** Number of buffered events */
+        bool            m_ownsEvents;           /** Event buffer has been allocated by registerButtonBatchCallback() */
+
+        ButtonSubscription* m_pSubscriptions;   /** List of registered subscriptions */
+        uint8_t         m_subscribedKinds;      /** Event kinds of all registered subscriptions */
+        ButtonChord*    m_pChords;              /** List of registered chords */
+        Keymap*         m_pKeymap;              /** Keymap resolving the key codes of the events (may be NULL) */
 
         static const uint16_t   s_defaultScanInterval = 20;     /** Default scan interval in ms */
         static const uint16_t   s_defaultLongPressMS = 2000;    /** Default interval for long press is 2000 ms */
     };
+
+
+
+    /**
+        @brief Memory of a matrix provided by the caller instead of being allocated on the heap
+               (required with BTNMATRIX_NO_HEAP). Holds the key bitmaps, the drive line bitmaps and
+               the bulk read buffers sized for the matrix, i.e. 18 bytes for a 4x4 keypad on AVR.
+               Declare it as static object and hand it to ButtonMatrix::setMemory() before init()
+        @tparam Rows
+                Number of rows of the matrix
+        @tparam Cols
+                Number of columns of the matrix
+    */
+    template <uint8_t Rows, uint8_t Cols>
+    struct MatrixMemory
+    {
+        KeySet::word_t  words[ButtonMatrix::getMemoryWords(Rows, Cols)];   /** Bitmaps and read buffers */
+#if BTNMATRIX_EVENT_MICROS
+        unsigned long   lineMicros[(Rows > Cols) ? Rows : Cols];           /** Sample times of the drive lines */
+#endif
+    };
 }
 
 
@@ -0,0 +1,127 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ButtonMatrixConfig.h
+  -----------------------------------------------------------------------------
+  @brief        Compile time configuration of the ButtonMatrix library
+                (all settings can be overridden by build flags)
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ButtonMatrixConfig_h
+#define ButtonMatrixConfig_h
+
+#include <Arduino.h>
+
+
+/**
+    @brief  Highest button number plus one the Button objects and the Keymap handle.
+            Values beyond 255 switch to 16 bit button numbers (btn_num_t), the Keymap keeps
+            4 bits per button for the layer each key has been pressed in.
+            The matrix itself is not limited by this value, its key bitmaps are sized by
+            its rows and columns (see ButtonMatrix::setMemory())
+*/
+#ifndef BTNMATRIX_MAX_BUTTONS
+    #if defined(__AVR__)
+        #define BTNMATRIX_MAX_BUTTONS 255
+    #else
+        #define BTNMATRIX_MAX_BUTTONS 256
+    #endif
+#endif
+
+
+/**
+    @brief  Number of events buffered for the batched event callback.
+            The buffer is allocated on the heap when the callback is registered (unless the caller
+            provides one). If more buttons change during a single scan, the callback is called several times
+*/
+#ifndef BTNMATRIX_MAX_BATCH_EVENTS
+    #if defined(__AVR__)
+        #define BTNMATRIX_MAX_BATCH_EVENTS 8
+    #else
+        #define BTNMATRIX_MAX_BATCH_EVENTS 16
+    #endif
+#endif
+
+
+/**
+    @brief  Maximum number of pins of a single MCP handled by one bulk IO operation
+            of the MultiMCPHandler (sizes its pin and bit buffers on the stack)
+*/
+#ifndef BTNMATRIX_MAX_LINES
+    #define BTNMATRIX_MAX_LINES 64
+#endif
+
+
+/**
+    @brief  Set to 1 to timestamp each state change in microseconds at the time its drive line
+            has been sampled (Button::getStateChangeMicros(), ButtonEvent::micros).
+            Costs 4 bytes per button and per drive line
+*/
+#ifndef BTNMATRIX_EVENT_MICROS
+    #if defined(__AVR__)
+        #define BTNMATRIX_EVENT_MICROS 0
+    #else
+        #define BTNMATRIX_EVENT_MICROS 1
+    #endif
+#endif
+
+
+/**
+    @brief  Resolution of the 16 bit timestamps kept by the CompactButtonStore
+            as power of two in ms (0 = 1 ms resolution, durations saturate at ~32 s,
+            2 = 4 ms resolution, durations saturate at ~131 s)
+*/
+#ifndef BTNMATRIX_COMPACT_TICK_SHIFT
+    #define BTNMATRIX_COMPACT_TICK_SHIFT 0
+#endif
+
+
+/**
+    @brief  Define BTNMATRIX_NO_HEAP to remove every heap allocating helper
+            (the getInstance() factories of the IO handlers) from the library.
+            IO handlers then have to be declared as (static) objects by the caller
+            and each matrix needs its memory provided by ButtonMatrix::setMemory()
+*/
+//#define BTNMATRIX_NO_HEAP
+
+
+/**
+    @brief  Define BTNMATRIX_WIDE_PINS to use 16 bit pin numbers throughout the library
+            (required for virtual pin spaces beyond 255, i.e. more than two MCPs
+            with the default MultiMCPHandler pin range of 100)
+*/
+//#define BTNMATRIX_WIDE_PINS
+
+
+namespace RSys
+{
+#ifdef BTNMATRIX_WIDE_PINS
+    typedef uint16_t pin_t;     /** Pin number (wide virtual pin space) */
+#else
+    typedef uint8_t pin_t;      /** Pin number */
+#endif
+
+#if BTNMATRIX_MAX_BUTTONS > 255
+    typedef uint16_t btn_num_t; /** Button number (large matrices) */
+#else
+    typedef uint8_t btn_num_t;  /** Button number (keeps buttons small for small builds) */
+#endif
+}
+
+
+#endif // ButtonMatrixConfig_h
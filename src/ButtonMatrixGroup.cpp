@@ -0,0 +1,193 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ButtonMatrixGroup.cpp
+  -----------------------------------------------------------------------------
+  @brief        Scheduling of several button matrices sharing one bus
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#include "ButtonMatrixGroup.h"
+
+
+namespace RSys
+{
+    ButtonMatrixGroup::ButtonMatrixGroup(ButtonMatrix** pMatrices, uint8_t numMatrices, ClockItf& clock)
+    //-----------------------------------------------------------------------------
+    :   m_pMatrices(pMatrices),
+        m_numMatrices(numMatrices),
+        m_clock(clock),
+        m_scanInterval(20),
+        m_maxScans(1),
+        m_next(0),
+        m_nextDue(0),
+        m_batchCallback(NULL),
+        m_batchContext(NULL),
+        m_curOffset(0)
+    {
+    }
+
+
+
+    bool ButtonMatrixGroup::init()
+    //-----------------------------------------------------------------------------
+    {
+        bool ok = true;
+        for (uint8_t idx = 0; idx < m_numMatrices; idx++)
+        {
+            m_pMatrices[idx]->setScanInterval(0);
+            ok = m_pMatrices[idx]->init() && ok;
+        }
+
+        m_next = 0;
+        m_nextDue = m_clock.millis();
+
+        return ok;
+    }
+
+
+
+    bool ButtonMatrixGroup::update()
+    //-----------------------------------------------------------------------------
+    {
+        bool hasAnyButtonChanged = false;
+        const unsigned long now = m_clock.millis();
+
+        // a full interval behind -> drop the missed slots instead of catching up in a burst
+        if ((long)(now - m_nextDue) >= (long)m_scanInterval + getSlotLength())
+        {
+            m_nextDue = now;
+        }
+
+        for (uint8_t scans = 0; scans < m_maxScans && 0 < m_numMatrices && (long)(now - m_nextDue) >= 0; scans++)
+        {
+            m_curOffset = toGroupIndex(m_next, 0);
+            hasAnyButtonChanged = m_pMatrices[m_next]->update() || hasAnyButtonChanged;
+
+            m_next = (m_next + 1) % m_numMatrices;
+            m_nextDue += getSlotLength();
+        }
+
+        return hasAnyButtonChanged;
+    }
+
+
+
+    unsigned long ButtonMatrixGroup::getTimeToNextUpdate() const
+    //-----------------------------------------------------------------------------
+    {
+        const long toDue = (long)(m_nextDue - m_clock.millis());
+        return (toDue <= 0) ? 0 : (unsigned long)toDue;
+    }
+
+
+
+    void ButtonMatrixGroup::setScanInterval(uint16_t scanInterval)
+    //-----------------------------------------------------------------------------
+    {
+        m_scanInterval = scanInterval;
+    }
+
+
+
+    uint16_t ButtonMatrixGroup::getNumButtons() const
+    //-----------------------------------------------------------------------------
+    {
+        return toGroupIndex(m_numMatrices, 0);
+    }
+
+
+
+    bool ButtonMatrixGroup::toMatrixIndex(uint16_t idx, uint8_t& matrixIdx, uint16_t& btnIdx) const
+    //-----------------------------------------------------------------------------
+    {
+        for (matrixIdx = 0; matrixIdx < m_numMatrices; matrixIdx++)
+        {
+            const uint16_t numButtons = m_pMatrices[matrixIdx]->getNumButtons();
+            if (idx < numButtons)
+            {
+                btnIdx = idx;
+                return true;
+            }
+            idx -= numButtons;
+        }
+
+        return false;
+    }
+
+
+
+    uint16_t ButtonMatrixGroup::toGroupIndex(uint8_t matrixIdx, uint16_t btnIdx) const
+    //-----------------------------------------------------------------------------
+    {
+        for (uint8_t idx = 0; idx < matrixIdx && idx < m_numMatrices; idx++)
+        {
+            btnIdx += m_pMatrices[idx]->getNumButtons();
+        }
+
+        return btnIdx;
+    }
+
+
+
+    Button* ButtonMatrixGroup::getButton(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        uint8_t matrixIdx = 0;
+        uint16_t btnIdx = 0;
+
+        return toMatrixIndex(idx, matrixIdx, btnIdx) ? m_pMatrices[matrixIdx]->getButton(btnIdx) : NULL;
+    }
+
+
+
+    void ButtonMatrixGroup::registerButtonBatchCallback(ButtonMatrix::btnBatchFnc cb, void* ctx)
+    //-----------------------------------------------------------------------------
+    {
+        m_batchCallback = cb;
+        m_batchContext = ctx;
+
+        for (uint8_t idx = 0; idx < m_numMatrices; idx++)
+        {
+            m_pMatrices[idx]->registerButtonBatchCallback((NULL != cb) ? forwardEvents : NULL, this);
+        }
+    }
+
+
+
+    void ButtonMatrixGroup::forwardEvents(void* ctx, const ButtonEvent* events, uint8_t numEvents)
+    //-----------------------------------------------------------------------------
+    {
+        ButtonMatrixGroup* pGroup = static_cast<ButtonMatrixGroup*>(ctx);
+        ButtonEvent groupEvents[BTNMATRIX_MAX_BATCH_EVENTS];
+
+        if (NULL != pGroup->m_batchCallback)
+        {
+            // a matrix may use a larger caller provided buffer -> forward it in chunks
+            for (uint16_t first = 0; first < numEvents; first += BTNMATRIX_MAX_BATCH_EVENTS)
+            {
+                uint8_t num = 0;
+                for (; first + num < numEvents && num < BTNMATRIX_MAX_BATCH_EVENTS; num++)
+                {
+                    groupEvents[num] = events[first + num];
+                    groupEvents[num].idx += pGroup->m_curOffset;
+                }
+                pGroup->m_batchCallback(pGroup->m_batchContext, groupEvents, num);
+            }
+        }
+    }
+}
@@ -0,0 +1,181 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ButtonMatrixGroup.h
+  -----------------------------------------------------------------------------
+  @brief        Scheduling of several button matrices sharing one bus
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ButtonMatrixGroup_h
+#define ButtonMatrixGroup_h
+
+#include <Arduino.h>
+#include "ButtonMatrix.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Scans several matrices round-robin with staggered phases.
+               Each matrix is scanned once per scan interval in its own time slot
+               (interval / number of matrices), so the scans never bunch up on the bus.
+               The buttons of all matrices share one index space (the buttons of the
+               first matrix, followed by the buttons of the second matrix and so on)
+    */
+    class ButtonMatrixGroup
+    {
+    public:
+
+        /**
+            @brief  c'tor
+            @param  pMatrices
+                    Array of matrices (declare matrices and array as static objects)
+            @param  numMatrices
+                    Number of matrices in the array
+            @param  clock
+                    Time source (must be the same the matrices use)
+        */
+        ButtonMatrixGroup(ButtonMatrix** pMatrices, uint8_t numMatrices,
+                          ClockItf& clock = NativeClock::getDefault());
+
+        /**
+            @brief  Initializes all matrices. The group takes over the scan timing,
+                    so the scan intervals of the matrices are set to 0
+                    (call it instead of the init() methods of the matrices)
+            @return True if all matrices succeeded
+        */
+        bool init();
+
+        /**
+            @brief  Scans the matrices whose time slots are due, but not more than the
+                    bus budget allows (call it each time the Arduinos loop() function is executed)
+            @return True if the state of any button has changed
+        */
+        bool update();
+
+        /**
+            @brief  Gets the time until the next time slot is due
+            @return Time in ms (0 if update() is due)
+        */
+        unsigned long getTimeToNextUpdate() const;
+
+        /**
+            @brief  Sets the interval each matrix is scanned in (default is 20 ms)
+            @param  scanInterval
+                    Scan interval in ms
+        */
+        void setScanInterval(uint16_t scanInterval);
+
+        /**
+            @brief  Gets the scan interval of each matrix
+            @return Scan interval in ms
+        */
+        inline uint16_t getScanInterval() const { return m_scanInterval; }
+
+        /**
+            @brief  Sets the maximum number of matrix scans within a single update()
+                    (limits the bus load if update() has been delayed, default is 1)
+            @param  maxScans
+                    Maximum number of scans per update()
+        */
+        inline void setMaxScansPerUpdate(uint8_t maxScans) { m_maxScans = (0 < maxScans) ? maxScans : 1; }
+
+        /**
+            @brief  Gets the total number of buttons of all matrices
+            @return Number of buttons
+        */
+        uint16_t getNumButtons() const;
+
+        /**
+            @brief  Gets the matrix and its button index of a group button index
+            @param  idx
+                    Button index within the group
+            @param  matrixIdx
+                    Receives the index of the matrix
+            @param  btnIdx
+                    Receives the button index within the matrix
+            @return False if the index is out of range
+        */
+        bool toMatrixIndex(uint16_t idx, uint8_t& matrixIdx, uint16_t& btnIdx) const;
+
+        /**
+            @brief  Gets the group button index of a matrix button
+            @param  matrixIdx
+                    Index of the matrix
+            @param  btnIdx
+                    Button index within the matrix
+            @return Button index within the group
+        */
+        uint16_t toGroupIndex(uint8_t matrixIdx, uint16_t btnIdx) const;
+
+        /**
+            @brief  Gets a button by its group index
+            @param  idx
+                    Button index within the group
+            @return Pointer to the button (NULL if out of range or the matrix uses a CompactButtonStore)
+        */
+        Button* getButton(uint16_t idx) const;
+
+        /**
+            @brief  Registers a batched event callback for the buttons of all matrices.
+                    The events carry group button indices
+                    (replaces the batched event callbacks of the matrices)
+            @param  cb
+                    Callback function (NULL to unregister)
+            @param  ctx
+                    Context pointer passed to the callback
+        */
+        void registerButtonBatchCallback(ButtonMatrix::btnBatchFnc cb, void* ctx = NULL);
+
+    private:
+
+        /**
+            @brief  Forwards the events of the matrix being updated with group button indices
+            @param  ctx
+                    The group
+            @param  events
+                    Events of the matrix
+            @param  numEvents
+                    Number of events
+        */
+        static void forwardEvents(void* ctx, const ButtonEvent* events, uint8_t numEvents);
+
+        /**
+            @brief  Gets the time slot length of each matrix
+            @return Slot length in ms
+        */
+        inline uint16_t getSlotLength() const { return (0 < m_numMatrices) ? m_scanInterval / m_numMatrices : 0; }
+
+
+        ButtonMatrix** const m_pMatrices;   /** Array of matrices */
+        const uint8_t   m_numMatrices;      /** Number of matrices in the array */
+        ClockItf&       m_clock;            /** Time source */
+
+        uint16_t        m_scanInterval;     /** Scan interval of each matrix in ms */
+        uint8_t         m_maxScans;         /** Maximum number of matrix scans per update() */
+        uint8_t         m_next;             /** Index of the matrix scanned next */
+        unsigned long   m_nextDue;          /** Timestamp (millis) of the next time slot */
+
+        ButtonMatrix::btnBatchFnc m_batchCallback;  /** Batched event callback */
+        void*           m_batchContext;             /** Context of the batched event callback */
+        uint16_t        m_curOffset;                /** Group index of the first button of the matrix being updated */
+    };
+}
+
+
+#endif // ButtonMatrixGroup_h
@@ -0,0 +1,58 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ClockItf.h
+  -----------------------------------------------------------------------------
+  @brief        Interface for the time source used by the ButtonMatrix
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ClockItf_h
+#define ClockItf_h
+
+#include <Arduino.h>
+
+
+namespace RSys
+{
+    /**
+        @brief Abstract interface to a time source
+               The ButtonMatrix samples the clock once per scan and hands the
+               timestamp down to the buttons
+    */
+    class ClockItf
+    {
+    public:
+
+        /**
+            @brief  Gets the current time
+            @return Time in ms (roll over after ~50 days!)
+        */
+        virtual unsigned long millis() = 0;
+
+        /**
+            @brief  Gets the current time in microseconds
+                    (the default derives it from millis(), override it for a finer resolution)
+            @return Time in us (roll over after ~70 minutes!)
+        */
+        virtual unsigned long micros() { return millis() * 1000UL; }
+    };
+
+}
+
+
+#endif // ClockItf_h
@@ -0,0 +1,342 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         CompactButtonStore.cpp
+  -----------------------------------------------------------------------------
+  @brief        Memory saving button state store for large matrices
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#include "CompactButtonStore.h"
+
+
+namespace RSys
+{
+
+    CompactButtonStore::CompactButtonStore(uint16_t numKeys, uint16_t* pStamps, uint8_t* pGestures, KeySet::word_t* pPlanes)
+    //-----------------------------------------------------------------------------
+    :   m_pStamps(pStamps),
+        m_pGestures(pGestures),
+        m_numKeys((NULL != pPlanes) ? numKeys : 0),
+        m_ageIdx(0),
+        m_lastAge(0),
+        m_pClock(&NativeClock::getDefault())
+    {
+        // one plane after the other, each of them holding all buttons
+        KeySet* planes[s_numPlanes] = { &m_cur, &m_enabled, &m_changed, &m_fell, &m_rose, &m_longPress, &m_swallow };
+        const uint16_t numWords = KeySet::wordsFor(m_numKeys);
+        for (uint8_t plane = 0; plane < s_numPlanes; plane++)
+        {
+            planes[plane]->attach(pPlanes + plane * numWords, numWords);
+        }
+        reset(0);
+    }
+
+
+    void CompactButtonStore::reset(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        m_cur.clear();
+        m_enabled.clear();
+        m_changed.clear();
+        m_fell.clear();
+        m_rose.clear();
+        m_longPress.clear();
+        m_swallow.clear();
+
+        const uint16_t ticks = toTicks(now);
+        for (uint16_t idx = 0; idx < m_numKeys; idx++)
+        {
+            m_enabled.set(idx);
+            m_pStamps[idx] = ticks;
+            m_pGestures[idx] = s_uninitialized;
+        }
+        m_ageIdx = 0;
+        m_lastAge = now;
+    }
+
+
+    void CompactButtonStore::age(unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        if (0 == m_numKeys)
+        {
+            return;
+        }
+
+        // share of the buttons due for the time elapsed, rounded up, so all of them
+        // are visited within each s_agePeriod regardless of the call rate
+        const unsigned long elapsed = (now - m_lastAge) >> BTNMATRIX_COMPACT_TICK_SHIFT;
+        uint16_t numAged = m_numKeys;
+        if (elapsed < s_agePeriod)
+        {
+            numAged = ((uint32_t)m_numKeys * elapsed + s_agePeriod - 1) / s_agePeriod;
+        }
+        if (0 == numAged)
+        {
+            return;
+        }
+        m_lastAge = now;
+
+        // clamp the timestamps before the 16 bit difference can wrap around
+        const uint16_t ticks = toTicks(now);
+        for (; numAged > 0; numAged--)
+        {
+            if ((uint16_t)(ticks - m_pStamps[m_ageIdx]) >= s_maxAge)
+            {
+                m_pStamps[m_ageIdx] = ticks - s_maxAge;
+            }
+
+            if (++m_ageIdx >= m_numKeys)
+            {
+                m_ageIdx = 0;
+            }
+        }
+    }
+
+
+    bool CompactButtonStore::isEnabled(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        return m_enabled.test(idx);
+    }
+
+
+    void CompactButtonStore::setEnabled(uint16_t idx, bool bEnabled)
+    //-----------------------------------------------------------------------------
+    {
+        if (idx < m_numKeys)
+        {
+            m_enabled.set(idx, bEnabled);
+        }
+    }
+
+
+    BTN_STATE CompactButtonStore::getCurState(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        return isPressed(idx) ? BTN_STATE_PRESSED : BTN_STATE_RELEASED;
+    }
+
+
+    BTN_STATE CompactButtonStore::getPrevState(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        BTN_STATE state = BTN_STATE_UNINITIALIZED;
+        if (idx < m_numKeys && s_uninitialized != (m_pGestures[idx] & s_durationMask))
+        {
+            // after the first change the previous state is always the opposite of the current one
+            state = m_cur.test(idx) ? BTN_STATE_RELEASED : BTN_STATE_PRESSED;
+        }
+        return state;
+    }
+
+
+    bool CompactButtonStore::isPressed(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        // Only report pressed if button is enabled
+        return m_cur.test(idx) && m_enabled.test(idx);
+    }
+
+
+    bool CompactButtonStore::isLongPressed(uint16_t idx, uint16_t ms, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        bool long_press = false;
+
+        if (!m_longPress.test(idx) && isPressed(idx) && getCurStateDuration(idx, now) >= ms)
+        {
+            long_press = true;
+            m_longPress.set(idx);
+        }
+
+        return long_press;
+    }
+
+
+    unsigned long CompactButtonStore::getCurStateDuration(uint16_t idx, unsigned long now) const
+    //-----------------------------------------------------------------------------
+    {
+        unsigned long duration = 0;
+        if (idx < m_numKeys)
+        {
+            duration = (unsigned long)(uint16_t)(toTicks(now) - m_pStamps[idx]) << BTNMATRIX_COMPACT_TICK_SHIFT;
+        }
+        return duration;
+    }
+
+
+    unsigned long CompactButtonStore::getPrevStateDuration(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        unsigned long duration = 0;
+        if (idx < m_numKeys)
+        {
+            const uint8_t code = m_pGestures[idx] & s_durationMask;
+            if (s_uninitialized != code)
+            {
+                duration = decodeDuration(code) << BTNMATRIX_COMPACT_TICK_SHIFT;
+            }
+        }
+        return duration;
+    }
+
+
+    void CompactButtonStore::swallowNextRoseEvent(uint16_t idx, bool bSwallow)
+    //-----------------------------------------------------------------------------
+    {
+        if (idx < m_numKeys)
+        {
+            m_swallow.set(idx, bSwallow);
+        }
+    }
+
+
+    bool CompactButtonStore::hasStateChanged(uint16_t idx)
+    //-----------------------------------------------------------------------------
+    {
+        bool result = m_changed.test(idx);
+        m_changed.reset(idx);
+        return result;
+    }
+
+
+    bool CompactButtonStore::fell(uint16_t idx)
+    //-----------------------------------------------------------------------------
+    {
+        // only report a fell when button is enabled
+        bool result = m_fell.test(idx) && m_enabled.test(idx);
+        m_fell.reset(idx);
+        m_changed.reset(idx);
+        return result;
+    }
+
+
+    bool CompactButtonStore::rose(uint16_t idx)
+    //-----------------------------------------------------------------------------
+    {
+        // only report a rose when button is enabled
+        bool result = m_rose.test(idx) && m_enabled.test(idx);
+        m_rose.reset(idx);
+        m_changed.reset(idx);
+        return result;
+    }
+
+
+    BTN_ACTION CompactButtonStore::getLastAction(uint16_t idx, bool resetafter)
+    //-----------------------------------------------------------------------------
+    {
+        BTN_ACTION act = BTN_ACTION_NONE;
+        if (idx < m_numKeys)
+        {
+            const uint8_t code = m_pGestures[idx] >> s_actionShift;
+            act = (s_repeatCode == code) ? BTN_ACTION_REPEAT : (BTN_ACTION)code;
+            if (resetafter)
+            {
+                m_pGestures[idx] &= s_durationMask;
+            }
+        }
+        return act;
+    }
+
+
+    bool CompactButtonStore::updateState(uint16_t idx, const BTN_STATE newState, const unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        if (idx >= m_numKeys)
+        {
+            return false;
+        }
+
+        const bool pressed = BTN_STATE_PRESSED == newState;
+
+        // we just update if the new state differs from the current one
+        if (pressed != m_cur.test(idx))
+        {
+            const uint16_t ticks = toTicks(now);
+            const uint8_t code = encodeDuration(ticks - m_pStamps[idx]);
+            m_pGestures[idx] = (m_pGestures[idx] & (uint8_t)~s_durationMask) | code;
+            m_pStamps[idx] = ticks;
+
+            m_cur.set(idx, pressed);
+
+            // if button is disabled we do not report a state change
+            m_changed.set(idx, m_enabled.test(idx));
+            m_fell.set(idx, pressed);
+            if (!pressed)
+            {
+                // just report rose when swallow is not set
+                m_rose.set(idx, !m_swallow.test(idx) && !m_longPress.test(idx));
+                // reset swallow so we can notify the next rose again
+                m_swallow.reset(idx);
+            }
+            else
+            {
+                m_rose.reset(idx);
+                // Reset any long press
+                m_longPress.reset(idx);
+            }
+        }
+
+        return m_changed.test(idx);
+    }
+
+
+    void CompactButtonStore::updateAction(uint16_t idx, const BTN_ACTION action)
+    //-----------------------------------------------------------------------------
+    {
+        if (idx < m_numKeys)
+        {
+            // two bits per action: the repeat takes the code of the (not implemented) double click
+            const uint8_t code = (BTN_ACTION_REPEAT == action) ? s_repeatCode : (uint8_t)action;
+            m_pGestures[idx] = (m_pGestures[idx] & s_durationMask) | (uint8_t)(code << s_actionShift);
+        }
+    }
+
+
+    bool CompactButtonStore::doNotifyClick(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        return !m_longPress.test(idx);
+    }
+
+
+    uint8_t CompactButtonStore::encodeDuration(uint16_t ticks)
+    //-----------------------------------------------------------------------------
+    {
+        // codes 0..7 are exact, above that 2 mantissa bits with rounding
+        uint32_t mantissa = ticks;
+        uint8_t shift = 0;
+        while (mantissa > 7)
+        {
+            mantissa = (mantissa + 1) >> 1;
+            shift++;
+        }
+
+        uint8_t code = (0 == shift) ? (uint8_t)mantissa : (uint8_t)(((shift + 1) << 2) | (mantissa & 0x03));
+        return (code < s_uninitialized) ? code : s_uninitialized - 1;
+    }
+
+
+    unsigned long CompactButtonStore::decodeDuration(uint8_t code)
+    //-----------------------------------------------------------------------------
+    {
+        return (code < 8) ? code : (unsigned long)(0x04 | (code & 0x03)) << ((code >> 2) - 1);
+    }
+
+}
@@ -0,0 +1,262 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         CompactButtonStore.h
+  -----------------------------------------------------------------------------
+  @brief        Memory saving button state store for large matrices
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef CompactButtonStore_h
+#define CompactButtonStore_h
+
+#include <Arduino.h>
+#include "ButtonBaseItf.h"
+#include "KeySet.h"
+#include "NativeClock.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Keeps the state of all buttons of a matrix as struct of arrays.
+               Flags are stored as one bit plane per flag, timestamps as 16 bit
+               values relative to the matrix clock and the previous state duration
+               as 6 bit logarithmic value (rounded to within ~12%) sharing a byte
+               with the last action. All arrays are provided by the caller (see CompactButtons),
+               so the store takes 31 bits per button (about 5 bytes per button together with
+               the key bitmaps of the matrix).
+               Durations saturate at 32768 ticks (see BTNMATRIX_COMPACT_TICK_SHIFT).
+    */
+    class CompactButtonStore
+    {
+    public:
+
+        static const uint8_t s_numPlanes = 7;           /** Number of bit planes (key bitmaps) */
+
+        /**
+            @brief  c'tor
+            @param  numKeys
+                    Number of buttons
+            @param  pStamps
+                    Array of numKeys timestamps
+            @param  pGestures
+                    Array of numKeys gesture bytes
+            @param  pPlanes
+                    Array of s_numPlanes * KeySet::wordsFor(numKeys) words holding the bit planes
+        */
+        CompactButtonStore(uint16_t numKeys, uint16_t* pStamps, uint8_t* pGestures, KeySet::word_t* pPlanes);
+
+        /**
+            @brief  Resets all buttons to released and enabled
+            @param  now
+                    Current timestamp in ms
+        */
+        void reset(unsigned long now);
+
+        /**
+            @brief  Sets the time source of the ButtonView queries without timestamp
+                    (called by ButtonMatrix::init(), the native clock is used until then)
+            @param  clock
+                    Time source (i.e. the clock of the matrix)
+        */
+        inline void setClock(ClockItf& clock) { m_pClock = &clock; }
+
+        /**
+            @brief  Gets the time source of the queries without timestamp
+            @return Reference to the clock
+        */
+        inline ClockItf& getClock() const { return *m_pClock; }
+
+        /**
+            @brief  Gets the number of buttons in the store
+            @return Number of buttons
+        */
+        inline uint16_t getNumKeys() const { return m_numKeys; }
+
+        /**
+            @brief  Gets the bitmap of the currently pressed buttons
+                    (regardless of their enabled state)
+            @return Reference to the bitmap
+        */
+        inline const KeySet& getPressedKeys() const { return m_cur; }
+
+        /**
+            @brief  Keeps the 16 bit timestamps from wrapping around.
+                    Handles as many buttons as the time elapsed since the last call requires
+                    to visit all of them within 16384 ticks, so call it at least once per
+                    16384 ticks (the matrix calls it on each scan and processed deadline)
+            @param  now
+                    Current timestamp in ms
+        */
+        void age(unsigned long now);
+
+        bool isEnabled(uint16_t idx) const;
+        void setEnabled(uint16_t idx, bool bEnabled);
+        BTN_STATE getCurState(uint16_t idx) const;
+        BTN_STATE getPrevState(uint16_t idx) const;
+        bool isPressed(uint16_t idx) const;
+        bool isLongPressed(uint16_t idx, uint16_t ms, unsigned long now);
+        unsigned long getCurStateDuration(uint16_t idx, unsigned long now) const;
+        unsigned long getPrevStateDuration(uint16_t idx) const;
+        void swallowNextRoseEvent(uint16_t idx, bool bSwallow);
+        bool hasStateChanged(uint16_t idx);
+        bool fell(uint16_t idx);
+        bool rose(uint16_t idx);
+        BTN_ACTION getLastAction(uint16_t idx, bool resetafter);
+
+        /** @brief see ButtonBaseItf */
+        bool updateState(uint16_t idx, const BTN_STATE newState, const unsigned long now);
+        /** @brief see ButtonBaseItf */
+        void updateAction(uint16_t idx, const BTN_ACTION action);
+        /** @brief see ButtonBaseItf */
+        bool doNotifyClick(uint16_t idx) const;
+
+    private:
+
+        /**
+            @brief  Converts a timestamp in ms into 16 bit ticks
+            @param  now
+                    Timestamp in ms
+            @return Ticks
+        */
+        static inline uint16_t toTicks(unsigned long now) { return (uint16_t)(now >> BTNMATRIX_COMPACT_TICK_SHIFT); }
+
+        /**
+            @brief  Encodes a duration into a 6 bit logarithmic value
+            @param  ticks
+                    Duration in ticks
+            @return Encoded duration
+        */
+        static uint8_t encodeDuration(uint16_t ticks);
+
+        /**
+            @brief  Decodes a 6 bit logarithmic duration
+            @param  code
+                    Encoded duration
+            @return Duration in ticks
+        */
+        static unsigned long decodeDuration(uint8_t code);
+
+        static const uint8_t s_durationMask = 0x3F;     /** Gesture bits holding the previous state duration */
+        static const uint8_t s_uninitialized = 0x3F;    /** Duration code marking an uninitialized previous state */
+        static const uint8_t s_actionShift = 6;         /** Position of the last action in the gesture byte */
+        static const uint8_t s_repeatCode = 2;          /** Code of BTN_ACTION_REPEAT within the gesture byte */
+        static const uint16_t s_maxAge = 0x8000;        /** Ticks after which durations saturate */
+        static const uint16_t s_agePeriod = 0x4000;     /** Ticks within which all timestamps are aged */
+
+        // scanned every update
+        KeySet      m_cur;          /** Button is pressed */
+        KeySet      m_enabled;      /** Button is enabled */
+
+        // events, consumed by queries
+        KeySet      m_changed;      /** State has changed since the last state query */
+        KeySet      m_fell;         /** State fell recently */
+        KeySet      m_rose;         /** State rose recently */
+
+        // gesture tracking
+        KeySet      m_longPress;    /** Long press has been detected */
+        KeySet      m_swallow;      /** Next rose event shall be swallowed */
+
+        uint16_t*   m_pStamps;      /** Time (in ticks) at which the state changed last */
+        uint8_t*    m_pGestures;    /** Previous state duration (bits 0..5) and last action (bits 6..7) */
+
+        const uint16_t m_numKeys;   /** Number of buttons */
+        uint16_t    m_ageIdx;       /** Next button to be aged */
+        unsigned long m_lastAge;    /** Timestamp in ms of the last aged button */
+        ClockItf*   m_pClock;       /** Time source of the queries without timestamp */
+    };
+
+
+
+    /**
+        @brief Allocates a CompactButtonStore for a fixed number of buttons
+        @tparam NumKeys
+                Number of buttons (rows * columns)
+    */
+    template <uint16_t NumKeys>
+    class CompactButtons : public CompactButtonStore
+    {
+    public:
+
+        /**
+            @brief  c'tor
+        */
+        CompactButtons()
+        :   CompactButtonStore(NumKeys, m_stamps, m_gestures, m_planes)
+        {
+        }
+
+    private:
+
+        uint16_t        m_stamps[NumKeys];      /** Timestamp storage */
+        uint8_t         m_gestures[NumKeys];    /** Gesture storage */
+        KeySet::word_t  m_planes[s_numPlanes * KeySet::wordsFor(NumKeys)];  /** Bit plane storage */
+    };
+
+
+
+    /**
+        @brief Lightweight Button like view onto a single button of a CompactButtonStore.
+               Provides the same queries as the Button class (see there), the queries
+               without timestamp take the time from the clock of the store (see CompactButtonStore::setClock()).
+               The button number equals the index of the button in the matrix
+    */
+    class ButtonView
+    {
+    public:
+
+        /**
+            @brief  c'tor
+            @param  store
+                    Store holding the button state
+            @param  idx
+                    Index of the button
+        */
+        ButtonView(CompactButtonStore& store, uint16_t idx)
+        :   m_store(store),
+            m_idx(idx)
+        {
+        }
+
+        inline uint16_t getNumber() const { return m_idx; }
+        inline bool isEnabled() const { return m_store.isEnabled(m_idx); }
+        inline void setEnabled(bool bEnabled) { m_store.setEnabled(m_idx, bEnabled); }
+        inline BTN_STATE getCurState() const { return m_store.getCurState(m_idx); }
+        inline BTN_STATE getPrevState() const { return m_store.getPrevState(m_idx); }
+        inline bool isPressed() const { return m_store.isPressed(m_idx); }
+        inline bool isLongPressed(uint16_t ms) const { return m_store.isLongPressed(m_idx, ms, m_store.getClock().millis()); }
+        inline bool isLongPressed(uint16_t ms, unsigned long now) const { return m_store.isLongPressed(m_idx, ms, now); }
+        inline unsigned long getCurStateDuration() const { return m_store.getCurStateDuration(m_idx, m_store.getClock().millis()); }
+        inline unsigned long getCurStateDuration(unsigned long now) const { return m_store.getCurStateDuration(m_idx, now); }
+        inline unsigned long getPrevStateDuration() const { return m_store.getPrevStateDuration(m_idx); }
+        inline void swallowNextRoseEvent(bool bSwallow = true) { m_store.swallowNextRoseEvent(m_idx, bSwallow); }
+        inline bool hasStateChanged() const { return m_store.hasStateChanged(m_idx); }
+        inline bool fell() const { return m_store.fell(m_idx); }
+        inline bool rose() const { return m_store.rose(m_idx); }
+        inline BTN_ACTION getLastAction(bool resetafter = true) const { return m_store.getLastAction(m_idx, resetafter); }
+
+    private:
+
+        CompactButtonStore& m_store;    /** Store holding the button state */
+        const uint16_t      m_idx;      /** Index of the button */
+    };
+
+}
+
+
+#endif // CompactButtonStore_h
@@ -0,0 +1,249 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         HIDReportBuilder.cpp
+  -----------------------------------------------------------------------------
+  @brief        Incremental HID keyboard reports built from the button events
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#include "HIDReportBuilder.h"
+
+
+namespace RSys
+{
+    static const uint8_t s_usageErrorRollOver = 0x01;  /** Reported in all slots while too many keys are held */
+    static const uint8_t s_usageLeftControl = 0xE0;    /** First modifier usage */
+    static const uint8_t s_usageRightGui = 0xE7;       /** Last modifier usage */
+
+
+    HIDReportBuilder::HIDReportBuilder(ButtonMatrix& matrix, uint8_t* pReport, uint8_t reportLength, HID_PROTOCOL protocol)
+    //-----------------------------------------------------------------------------
+    :   m_matrix(matrix),
+        m_subscription(onEvent, BTN_EVENT_FELL | BTN_EVENT_ROSE, this),
+        m_pReport(pReport),
+        m_reportLength((NULL == pReport || reportLength < ((HID_BOOT == protocol) ? s_bootReportLength : 2))
+                       ? 0
+                       : ((HID_BOOT == protocol) ? s_bootReportLength : reportLength)),
+        m_protocol(protocol),
+        m_numOverflow(0),
+        m_changed(false)
+    {
+        clear();
+        m_matrix.subscribe(m_subscription);
+    }
+
+
+
+    HIDReportBuilder::~HIDReportBuilder()
+    //-----------------------------------------------------------------------------
+    {
+        m_matrix.unsubscribe(m_subscription);
+    }
+
+
+
+    void HIDReportBuilder::clear()
+    //-----------------------------------------------------------------------------
+    {
+        for (uint8_t idx = 0; idx < m_reportLength; idx++)
+        {
+            m_pReport[idx] = 0;
+        }
+        for (uint8_t idx = 0; idx < s_bootKeys; idx++)
+        {
+            m_keys[idx] = 0;
+        }
+        m_numOverflow = 0;
+        m_changed = true;
+    }
+
+
+
+    bool HIDReportBuilder::hasChanged()
+    //-----------------------------------------------------------------------------
+    {
+        const bool changed = m_changed;
+        m_changed = false;
+        return changed;
+    }
+
+
+
+    void HIDReportBuilder::onEvent(void* ctx, const ButtonEvent& event)
+    //-----------------------------------------------------------------------------
+    {
+        HIDReportBuilder* pBuilder = static_cast<HIDReportBuilder*>(ctx);
+        const bool pressed = BTN_STATE_PRESSED == event.state;
+
+        // layer keys and codes beyond the usage range do not show up in the report
+        if (0 == pBuilder->m_reportLength || BTN_KEY_NONE == event.keyCode || event.keyCode > s_usageRightGui)
+        {
+            return;
+        }
+        const uint8_t usage = (uint8_t)event.keyCode;
+
+        if (!pressed && pBuilder->isUsageHeld(usage))
+        {
+            // another button with the same usage is still held
+            return;
+        }
+
+        if (usage >= s_usageLeftControl)
+        {
+            const uint8_t bit = 1 << (usage - s_usageLeftControl);
+            pBuilder->m_pReport[0] = pressed ? (pBuilder->m_pReport[0] | bit) : (pBuilder->m_pReport[0] & ~bit);
+        }
+        else if (HID_BOOT == pBuilder->m_protocol)
+        {
+            pBuilder->updateBootKeys(usage, pressed);
+        }
+        else if (1 + usage / 8 < pBuilder->m_reportLength)
+        {
+            const uint8_t bit = 1 << (usage % 8);
+            uint8_t& byte = pBuilder->m_pReport[1 + usage / 8];
+            byte = pressed ? (byte | bit) : (byte & ~bit);
+        }
+        pBuilder->m_changed = true;
+    }
+
+
+
+    bool HIDReportBuilder::isUsageHeld(uint8_t usage) const
+    //-----------------------------------------------------------------------------
+    {
+        const Keymap* pKeymap = m_matrix.getKeymap();
+        const KeySet& pressed = m_matrix.getPressedKeys();
+        const KeySet& enabled = m_matrix.getEnabledKeys();
+
+        if (NULL == pKeymap)
+        {
+            return false;
+        }
+
+        // the button released is not part of the pressed keys anymore
+        for (uint16_t idx = pressed.findFirst(); KeySet::npos != idx && idx < m_matrix.getNumButtons(); idx = pressed.findNext(idx))
+        {
+            if (enabled.test(idx) && usage == pKeymap->getKeyCode(idx))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+
+    void HIDReportBuilder::updateBootKeys(uint8_t usage, bool pressed)
+    //-----------------------------------------------------------------------------
+    {
+        uint8_t slot = s_bootKeys;
+        for (uint8_t idx = 0; idx < s_bootKeys; idx++)
+        {
+            if (m_keys[idx] == usage || (s_bootKeys == slot && pressed && 0 == m_keys[idx]))
+            {
+                slot = idx;
+            }
+        }
+
+        if (pressed)
+        {
+            if (s_bootKeys == slot)
+            {
+                // all slots in use
+                m_numOverflow++;
+            }
+            else
+            {
+                m_keys[slot] = usage;
+            }
+        }
+        else
+        {
+            if (s_bootKeys != slot)
+            {
+                m_keys[slot] = 0;
+            }
+            if (0 < m_numOverflow)
+            {
+                // keys held beyond the six slots move into the slots freed
+                refillBootKeys();
+            }
+        }
+
+        writeBootKeys();
+    }
+
+
+
+    void HIDReportBuilder::refillBootKeys()
+    //-----------------------------------------------------------------------------
+    {
+        const Keymap* pKeymap = m_matrix.getKeymap();
+        const KeySet& pressed = m_matrix.getPressedKeys();
+        const KeySet& enabled = m_matrix.getEnabledKeys();
+
+        m_numOverflow = 0;
+        if (NULL == pKeymap)
+        {
+            return;
+        }
+
+        for (uint16_t idx = pressed.findFirst(); KeySet::npos != idx && idx < m_matrix.getNumButtons(); idx = pressed.findNext(idx))
+        {
+            // disabled buttons never report their press
+            const keycode_t keyCode = enabled.test(idx) ? pKeymap->getKeyCode(idx) : (keycode_t)BTN_KEY_NONE;
+            if (BTN_KEY_NONE == keyCode || keyCode >= s_usageLeftControl)
+            {
+                continue;
+            }
+
+            uint8_t slot = s_bootKeys;
+            for (uint8_t pos = 0; pos < s_bootKeys && s_bootKeys == slot; pos++)
+            {
+                if (m_keys[pos] == keyCode)
+                {
+                    slot = pos;
+                }
+            }
+            for (uint8_t pos = 0; pos < s_bootKeys && s_bootKeys == slot; pos++)
+            {
+                if (0 == m_keys[pos])
+                {
+                    slot = pos;
+                    m_keys[pos] = (uint8_t)keyCode;
+                }
+            }
+            if (s_bootKeys == slot)
+            {
+                m_numOverflow++;
+            }
+        }
+    }
+
+
+
+    void HIDReportBuilder::writeBootKeys()
+    //-----------------------------------------------------------------------------
+    {
+        for (uint8_t idx = 0; idx < s_bootKeys; idx++)
+        {
+            m_pReport[2 + idx] = (0 < m_numOverflow) ? s_usageErrorRollOver : m_keys[idx];
+        }
+    }
+}
@@ -0,0 +1,156 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         HIDReportBuilder.h
+  -----------------------------------------------------------------------------
+  @brief        Incremental HID keyboard reports built from the button events
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef HIDReportBuilder_h
+#define HIDReportBuilder_h
+
+#include <Arduino.h>
+#include "ButtonMatrix.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Layouts of the HID keyboard report
+    */
+    enum HID_PROTOCOL : unsigned char
+    {
+        HID_BOOT = 0,   /** Boot protocol: modifiers, reserved byte and up to six usages (8 bytes) */
+        HID_NKRO = 1    /** Modifiers followed by one bit per usage (usage n is bit n % 8 of byte 1 + n / 8) */
+    };
+
+
+    /**
+        @brief Maintains a HID keyboard report in a caller provided buffer.
+               The key codes of the matrix keymap (see ButtonMatrix::setKeymap()) are taken as
+               HID usage IDs, 0xE0...0xE7 are mapped onto the modifier bits. The report is
+               updated by each press and release only, so the effort per change does not depend
+               on the size of the matrix (no iteration over the buttons)
+    */
+    class HIDReportBuilder
+    {
+    public:
+
+        static const uint8_t s_bootReportLength = 8;    /** Length of a boot protocol report */
+        static const uint8_t s_bootKeys = 6;            /** Number of usages within a boot protocol report */
+
+        /**
+            @brief  c'tor, subscribes to the press and release events of all buttons of the matrix
+            @param  matrix
+                    The matrix (init() does not need to be called yet)
+            @param  pReport
+                    Buffer receiving the report (s_bootReportLength bytes for HID_BOOT,
+                    1 + number of usages / 8 bytes for HID_NKRO)
+            @param  reportLength
+                    Length of the buffer
+            @param  protocol
+                    Layout of the report
+        */
+        HIDReportBuilder(ButtonMatrix& matrix, uint8_t* pReport, uint8_t reportLength,
+                         HID_PROTOCOL protocol = HID_BOOT);
+
+        /**
+            @brief  d'tor
+        */
+        ~HIDReportBuilder();
+
+        /**
+            @brief  Clears the report (all keys released)
+        */
+        void clear();
+
+        /**
+            @brief  Determines whether or not the report has changed since the last call
+                    (call it after ButtonMatrix::update() to decide whether to send the report)
+            @return True if the report has changed
+        */
+        bool hasChanged();
+
+        /**
+            @brief  Gets the report
+            @return Pointer to the caller provided buffer
+        */
+        inline const uint8_t* getReport() const { return m_pReport; }
+
+        /**
+            @brief  Gets the length of the report
+            @return Length in bytes (0 if the buffer is too short for the protocol)
+        */
+        inline uint8_t getReportLength() const { return m_reportLength; }
+
+    private:
+
+        /**
+            @brief  Applies a press or release to the report
+            @param  ctx
+                    The builder
+            @param  event
+                    Fell or rose event
+        */
+        static void onEvent(void* ctx, const ButtonEvent& event);
+
+        /**
+            @brief  Determines whether or not another enabled button held maps onto a usage
+                    (checked on releases only, so keys sharing a usage are released with the last one)
+            @param  usage
+                    HID usage ID
+            @return True if any enabled button pressed has the usage as key code
+        */
+        bool isUsageHeld(uint8_t usage) const;
+
+        /**
+            @brief  Adds or removes a usage of the boot protocol report
+            @param  usage
+                    HID usage ID
+            @param  pressed
+                    True to add, false to remove the usage
+        */
+        void updateBootKeys(uint8_t usage, bool pressed);
+
+        /**
+            @brief  Moves the keys held beyond the six usages into free slots of the boot
+                    protocol report (recounts the pressed buttons, called on releases during
+                    a rollover only)
+        */
+        void refillBootKeys();
+
+        /**
+            @brief  Copies the usages into the boot protocol report
+                    (ErrorRollOver while more than six keys are held)
+        */
+        void writeBootKeys();
+
+
+        ButtonMatrix&       m_matrix;           /** The matrix */
+        ButtonSubscription  m_subscription;     /** Subscription to the press and release events */
+        uint8_t* const      m_pReport;          /** Caller provided report buffer */
+        const uint8_t       m_reportLength;     /** Length of the report */
+        const HID_PROTOCOL  m_protocol;         /** Layout of the report */
+        uint8_t             m_keys[s_bootKeys]; /** Usages of the boot protocol report */
+        uint8_t             m_numOverflow;      /** Keys held in addition to the six usages */
+        bool                m_changed;          /** The report has changed */
+    };
+}
+
+
+#endif // HIDReportBuilder_h
@@ -25,16 +25,25 @@
 #define IOHandlerItf_h
 
 #include <Arduino.h>
+#include "ButtonMatrixConfig.h"
 
 
 namespace RSys
 { 
+    class AsyncIOHandlerItf;
+
+
     /**
         @brief Abstract interface to handle IO      
     */  
     class IOHandlerItf
     {
     public:
+
+        /**
+            @brief  d'tor
+        */
+        virtual ~IOHandlerItf() {}
     
         /**
             @brief  Sets the mode of a pin
@@ -43,7 +52,7 @@ namespace RSys
             @param  mode
                     Mode to set
         */     
-        virtual void pinMode(uint8_t pin, uint8_t mode) = 0;
+        virtual void pinMode(pin_t pin, uint8_t mode) = 0;
 
         /**
             @brief  Sets the output pin to a particular state
@@ -52,7 +61,7 @@ namespace RSys
             @param  val
                     State value
         */ 
-        virtual void digitalWrite(uint8_t pin, uint8_t val) = 0;
+        virtual void digitalWrite(pin_t pin, uint8_t val) = 0;
 
         /**
             @brief  Reads the state of a pin
@@ -60,7 +69,122 @@ namespace RSys
                     Pin number
             @return Pin state
         */ 
-        virtual int digitalRead(uint8_t pin) = 0;
+        virtual int digitalRead(pin_t pin) = 0;
+
+        /**
+            @brief  Sets the mode of several pins at once.
+                    Backends able to configure a whole port override this
+            @param  pins
+                    Array of pin numbers
+            @param  numPins
+                    Number of pins in the array
+            @param  mode
+                    Mode to set
+        */
+        virtual void pinModeMulti(const pin_t* pins, uint8_t numPins, uint8_t mode)
+        {
+            for (uint8_t idx = 0; idx < numPins; idx++)
+            {
+                pinMode(pins[idx], mode);
+            }
+        }
+
+        /**
+            @brief  Sets several output pins to the same state at once.
+                    Backends able to write a whole port override this
+            @param  pins
+                    Array of pin numbers
+            @param  numPins
+                    Number of pins in the array
+            @param  val
+                    State value
+        */
+        virtual void digitalWriteMulti(const pin_t* pins, uint8_t numPins, uint8_t val)
+        {
+            for (uint8_t idx = 0; idx < numPins; idx++)
+            {
+                digitalWrite(pins[idx], val);
+            }
+        }
+
+        /**
+            @brief  Reads the state of several pins at once.
+                    Backends able to read a whole port override this to read all pins
+                    in a single transaction
+            @param  pins
+                    Array of pin numbers
+            @param  numPins
+                    Number of pins in the array
+            @param  mask
+                    Packed bits (LSB first) selecting the pins to be read, NULL to read all pins
+            @param  bits
+                    Packed bits (LSB first) receiving the pin states (set for HIGH),
+                    bits of pins not selected by the mask are undefined
+        */
+        virtual void digitalReadMulti(const pin_t* pins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+        {
+            for (uint8_t idx = 0; idx < numPins; idx++)
+            {
+                const uint8_t bit = 1 << (idx & 7);
+                if (0 == (idx & 7))
+                {
+                    bits[idx >> 3] = 0;
+                }
+                if ((NULL == mask || (mask[idx >> 3] & bit)) && HIGH == digitalRead(pins[idx]))
+                {
+                    bits[idx >> 3] |= bit;
+                }
+            }
+        }
+
+        /**
+            @brief  Sets an output pin and reads the state of several pins afterwards.
+                    Backends able to combine both into a single bus transaction override this,
+                    the default just writes the pin and calls digitalReadMulti()
+            @param  drivePin
+                    Output pin number
+            @param  driveVal
+                    State value of the output pin
+            @param  settleUs
+                    Time in microseconds to wait between driving and reading (0 for none)
+            @param  pins
+                    Array of pin numbers to be read
+            @param  numPins
+                    Number of pins in the array
+            @param  mask
+                    Packed bits (LSB first) selecting the pins to be read, NULL to read all pins
+            @param  bits
+                    Packed bits (LSB first) receiving the pin states (set for HIGH)
+        */
+        virtual void driveAndRead(pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                                  const pin_t* pins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+        {
+            digitalWrite(drivePin, driveVal);
+            if (0 < settleUs)
+            {
+                delayMicroseconds(settleUs);
+            }
+            digitalReadMulti(pins, numPins, mask, bits);
+        }
+
+        /**
+            @brief  Drops any state cached from the hardware (i.e. output latches), so it is read again.
+                    Called by ButtonMatrix::reinit() as the hardware may have been reset
+        */
+        virtual void invalidate() {}
+
+        /**
+            @brief  Determines whether or not the handler is able to address all of its pins
+                    (checked by ButtonMatrix::init(), which fails otherwise)
+            @return True if the handler is usable
+        */
+        virtual bool isValid() const { return true; }
+
+        /**
+            @brief  Gets the asynchronous interface of the handler (avoids RTTI)
+            @return Pointer to the asynchronous interface or NULL if the handler just works synchronously
+        */
+        virtual AsyncIOHandlerItf* asAsync() { return NULL; }
     };
 
 
@@ -0,0 +1,452 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         KeySet.h
+  -----------------------------------------------------------------------------
+  @brief        Packed bitmap with one bit per button of a matrix
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef KeySet_h
+#define KeySet_h
+
+#include <Arduino.h>
+#include "ButtonMatrixConfig.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Set of indices stored as a packed bitmap in caller provided words
+               (bit n represents the button or line with index n in the matrix).
+               The set just refers to its words, so it is not copyable. Assigning
+               a set copies the bits, bits beyond the capacity of a set are taken as 0.
+               Use FixedKeySet for a set owning its words
+    */
+    class KeySet
+    {
+    public:
+
+    #if defined(__AVR__)
+        typedef uint8_t word_t;     /** Native word size on 8 bit controllers */
+    #else
+        typedef uint32_t word_t;    /** Native word size on 32 bit controllers */
+    #endif
+
+        static const uint8_t  bitsPerWord = sizeof(word_t) * 8;     /** Number of bits in a word */
+        static const uint16_t npos = 0xFFFF;                        /** Returned if no key was found */
+
+        /**
+            @brief  Gets the number of words holding a number of keys
+            @param  numKeys
+                    Number of keys
+            @return Number of words
+        */
+        static constexpr uint16_t wordsFor(uint16_t numKeys)
+        {
+            return (numKeys + bitsPerWord - 1) / bitsPerWord;
+        }
+
+        /**
+            @brief  c'tor (creates an empty set without any words, see attach())
+        */
+        KeySet()
+        :   m_pWords(NULL),
+            m_numWords(0)
+        {
+        }
+
+        /**
+            @brief  c'tor (creates an empty set)
+            @param  pWords
+                    Words holding the bits (cleared)
+            @param  numWords
+                    Number of words
+        */
+        KeySet(word_t* pWords, uint16_t numWords)
+        :   m_pWords(pWords),
+            m_numWords((NULL != pWords) ? numWords : 0)
+        {
+            clear();
+        }
+
+        KeySet(const KeySet&) = delete;
+
+        /**
+            @brief  Uses other words for the bits (the words are taken as they are)
+            @param  pWords
+                    Words holding the bits
+            @param  numWords
+                    Number of words
+        */
+        inline void attach(word_t* pWords, uint16_t numWords)
+        {
+            m_pWords = pWords;
+            m_numWords = (NULL != pWords) ? numWords : 0;
+        }
+
+        /**
+            @brief  Gets the number of keys the set can hold
+            @return Capacity of the set
+        */
+        inline uint16_t getCapacity() const
+        {
+            const uint32_t capacity = (uint32_t)m_numWords * bitsPerWord;
+            return (capacity < npos) ? (uint16_t)capacity : npos - 1;
+        }
+
+        /**
+            @brief  Gets the number of words of the set
+            @return Number of words
+        */
+        inline uint16_t getNumWords() const { return m_numWords; }
+
+        /**
+            @brief  Removes all keys from the set
+        */
+        inline void clear()
+        {
+            for (uint16_t w = 0; w < m_numWords; w++) m_pWords[w] = 0;
+        }
+
+        /**
+            @brief  Adds or removes a key
+            @param  idx
+                    Index of the key (ignored if out of range)
+            @param  val
+                    True to add the key, false to remove it
+        */
+        inline void set(uint16_t idx, bool val = true)
+        {
+            if (idx / bitsPerWord < m_numWords)
+            {
+                const word_t mask = (word_t)1 << (idx % bitsPerWord);
+                if (val)
+                {
+                    m_pWords[idx / bitsPerWord] |= mask;
+                }
+                else
+                {
+                    m_pWords[idx / bitsPerWord] &= (word_t)~mask;
+                }
+            }
+        }
+
+        /**
+            @brief  Removes a key
+            @param  idx
+                    Index of the key
+        */
+        inline void reset(uint16_t idx) { set(idx, false); }
+
+        /**
+            @brief  Determines whether or not a key is part of the set
+            @param  idx
+                    Index of the key
+            @return True, if the key is in the set (false if out of range)
+        */
+        inline bool test(uint16_t idx) const
+        {
+            return (idx / bitsPerWord < m_numWords) && (0 != (m_pWords[idx / bitsPerWord] & ((word_t)1 << (idx % bitsPerWord))));
+        }
+
+        /**
+            @brief  Determines whether or not the set contains any key
+            @return True, if at least one key is in the set
+        */
+        bool any() const
+        {
+            for (uint16_t w = 0; w < m_numWords; w++)
+            {
+                if (0 != m_pWords[w]) return true;
+            }
+            return false;
+        }
+
+        /**
+            @brief  Counts the keys in the set
+            @return Number of keys
+        */
+        uint16_t count() const
+        {
+            uint16_t cnt = 0;
+            for (uint16_t w = 0; w < m_numWords; w++)
+            {
+                cnt += countBits(m_pWords[w]);
+            }
+            return cnt;
+        }
+
+        /**
+            @brief  Gets the first key in the set
+            @return Index of the key or npos if the set is empty
+        */
+        inline uint16_t findFirst() const { return findFrom(NULL, 0); }
+
+        /**
+            @brief  Gets the next key in the set following the given one
+            @param  idx
+                    Index of the previous key
+            @return Index of the key or npos if there is none
+        */
+        inline uint16_t findNext(uint16_t idx) const { return findFrom(NULL, idx + 1); }
+
+        /**
+            @brief  Counts the keys in just one of both sets (without building their difference)
+            @param  other
+                    Set to compare with
+            @return Number of keys
+        */
+        uint16_t countDiff(const KeySet& other) const
+        {
+            uint16_t cnt = 0;
+            for (uint16_t w = 0; w < m_numWords || w < other.m_numWords; w++)
+            {
+                cnt += countBits(getWord(w) ^ other.getWord(w));
+            }
+            return cnt;
+        }
+
+        /**
+            @brief  Gets the first key in just one of both sets
+            @param  other
+                    Set to compare with
+            @return Index of the key or npos if both sets are equal
+        */
+        inline uint16_t findFirstDiff(const KeySet& other) const { return findFrom(&other, 0); }
+
+        /**
+            @brief  Gets the next key in just one of both sets following the given one
+            @param  other
+                    Set to compare with
+            @param  idx
+                    Index of the previous key
+            @return Index of the key or npos if there is none
+        */
+        inline uint16_t findNextDiff(const KeySet& other, uint16_t idx) const { return findFrom(&other, idx + 1); }
+
+        /**
+            @brief  Determines whether or not both sets share any key
+            @param  other
+                    Set to compare with
+            @return True, if at least one key is in both sets
+        */
+        bool intersects(const KeySet& other) const
+        {
+            for (uint16_t w = 0; w < m_numWords && w < other.m_numWords; w++)
+            {
+                if (0 != (m_pWords[w] & other.m_pWords[w])) return true;
+            }
+            return false;
+        }
+
+        /**
+            @brief  Determines whether or not all keys of the other set are in this set
+            @param  other
+                    Set to compare with
+            @return True, if other is a subset of this set
+        */
+        bool contains(const KeySet& other) const
+        {
+            for (uint16_t w = 0; w < other.m_numWords; w++)
+            {
+                if (0 != (other.m_pWords[w] & (word_t)~getWord(w))) return false;
+            }
+            return true;
+        }
+
+        /**
+            @brief  Copies the keys of the other set
+            @param  other
+                    Set to copy
+            @return Reference to this set
+        */
+        KeySet& operator=(const KeySet& other)
+        {
+            for (uint16_t w = 0; w < m_numWords; w++) m_pWords[w] = other.getWord(w);
+            return *this;
+        }
+
+        KeySet& operator&=(const KeySet& other)
+        {
+            for (uint16_t w = 0; w < m_numWords; w++) m_pWords[w] &= other.getWord(w);
+            return *this;
+        }
+
+        KeySet& operator|=(const KeySet& other)
+        {
+            for (uint16_t w = 0; w < m_numWords; w++) m_pWords[w] |= other.getWord(w);
+            return *this;
+        }
+
+        KeySet& operator^=(const KeySet& other)
+        {
+            for (uint16_t w = 0; w < m_numWords; w++) m_pWords[w] ^= other.getWord(w);
+            return *this;
+        }
+
+        /**
+            @brief  Removes all keys of the other set from this set
+            @param  other
+                    Keys to remove
+            @return Reference to this set
+        */
+        KeySet& operator-=(const KeySet& other)
+        {
+            for (uint16_t w = 0; w < m_numWords; w++) m_pWords[w] &= (word_t)~other.getWord(w);
+            return *this;
+        }
+
+        bool operator==(const KeySet& other) const
+        {
+            return npos == findFirstDiff(other);
+        }
+
+        inline bool operator!=(const KeySet& other) const { return !(*this == other); }
+
+        /**
+            @brief  Gets a word of the bitmap
+            @param  w
+                    Word index
+            @return The word (0 beyond the words of the set)
+        */
+        inline word_t getWord(uint16_t w) const { return (w < m_numWords) ? m_pWords[w] : 0; }
+
+        /**
+            @brief  Sets a word of the bitmap
+            @param  w
+                    Word index (ignored beyond the words of the set)
+            @param  val
+                    New value of the word
+        */
+        inline void setWord(uint16_t w, word_t val)
+        {
+            if (w < m_numWords)
+            {
+                m_pWords[w] = val;
+            }
+        }
+
+    private:
+
+        /**
+            @brief  Counts the bits set in a word
+            @param  v
+                    The word
+            @return Number of bits
+        */
+        static inline uint8_t countBits(word_t v)
+        {
+            uint8_t cnt = 0;
+            for (; 0 != v; v &= (word_t)(v - 1))
+            {
+                cnt++;
+            }
+            return cnt;
+        }
+
+        /**
+            @brief  Gets the first key in the set (or in just one of both sets) starting at the given index
+            @param  pOther
+                    Set to compare with (NULL to search this set)
+            @param  idx
+                    Index to start searching at
+            @return Index of the key or npos if there is none
+        */
+        uint16_t findFrom(const KeySet* pOther, uint16_t idx) const
+        {
+            const uint16_t numWords = (NULL != pOther && pOther->m_numWords > m_numWords) ? pOther->m_numWords : m_numWords;
+            uint16_t w = idx / bitsPerWord;
+            if (w >= numWords) return npos;
+
+            // mask out all bits below the start index in the first word
+            word_t v = (getWord(w) ^ ((NULL != pOther) ? pOther->getWord(w) : 0)) & (word_t)(~(word_t)0 << (idx % bitsPerWord));
+            while (0 == v)
+            {
+                if (++w >= numWords) return npos;
+                v = getWord(w) ^ ((NULL != pOther) ? pOther->getWord(w) : 0);
+            }
+
+            uint16_t bit = 0;
+            while (0 == (v & 1))
+            {
+                v >>= 1;
+                bit++;
+            }
+            return w * bitsPerWord + bit;
+        }
+
+        word_t*     m_pWords;       /** Packed key bits */
+        uint16_t    m_numWords;     /** Number of words */
+    };
+
+
+
+    /**
+        @brief Key set owning its words
+        @tparam Capacity
+                Maximum number of indices (i.e. rows * columns of the matrix)
+    */
+    template <uint16_t Capacity>
+    class FixedKeySet : public KeySet
+    {
+    public:
+
+        /**
+            @brief  c'tor (creates an empty set)
+        */
+        FixedKeySet()
+        {
+            attach(m_words, s_numWords);
+            clear();
+        }
+
+        /**
+            @brief  c'tor (copies the keys of another set)
+            @param  other
+                    Set to copy
+        */
+        FixedKeySet(const FixedKeySet& other)
+        :   KeySet()
+        {
+            attach(m_words, s_numWords);
+            KeySet::operator=(other);
+        }
+
+        FixedKeySet& operator=(const FixedKeySet& other)
+        {
+            KeySet::operator=(other);
+            return *this;
+        }
+
+        FixedKeySet& operator=(const KeySet& other)
+        {
+            KeySet::operator=(other);
+            return *this;
+        }
+
+    private:
+
+        static const uint16_t s_numWords = KeySet::wordsFor(Capacity);   /** Number of words */
+
+        word_t  m_words[s_numWords];    /** Packed key bits */
+    };
+
+}
+
+
+#endif // KeySet_h
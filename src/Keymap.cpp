@@ -0,0 +1,166 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         Keymap.cpp
+  -----------------------------------------------------------------------------
+  @brief        Layered mapping of button indices to application key codes
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#include "Keymap.h"
+
+#if defined(__AVR__)
+    #include <avr/pgmspace.h>
+#endif
+
+
+namespace RSys
+{
+    Keymap::Keymap(const keycode_t* pTable, uint8_t numLayers, uint16_t numKeys, bool inProgmem)
+    //-----------------------------------------------------------------------------
+    :   m_pTable(pTable),
+        m_numLayers((numLayers < s_maxLayers) ? numLayers : s_maxLayers),
+        m_numKeys(numKeys),
+        m_inProgmem(inProgmem),
+        m_momentaryLayers(0),
+        m_toggledLayers(0)
+    {
+        for (uint16_t idx = 0; idx < sizeof(m_keyLayers); idx++)
+        {
+            m_keyLayers[idx] = 0;
+        }
+        for (uint8_t layer = 0; layer < s_maxLayers; layer++)
+        {
+            m_momentaryHolders[layer] = 0;
+        }
+    }
+
+
+
+    keycode_t Keymap::getKeyCode(uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        if (idx >= m_numKeys || idx >= BTNMATRIX_MAX_BUTTONS)
+        {
+            return BTN_KEY_NONE;
+        }
+
+        const uint8_t layer = (m_keyLayers[idx / 2] >> ((idx & 1) * 4)) & 0x0F;
+        return lookup(layer, idx);
+    }
+
+
+
+    keycode_t Keymap::lookup(uint8_t layer, uint16_t idx) const
+    //-----------------------------------------------------------------------------
+    {
+        if (layer >= m_numLayers || idx >= m_numKeys || NULL == m_pTable)
+        {
+            return BTN_KEY_NONE;
+        }
+
+        const keycode_t* pCode = &m_pTable[(uint32_t)layer * m_numKeys + idx];
+#if defined(__AVR__)
+        return m_inProgmem ? (keycode_t)pgm_read_word(pCode) : *pCode;
+#else
+        return *pCode;
+#endif
+    }
+
+
+
+    keycode_t Keymap::press(uint16_t idx)
+    //-----------------------------------------------------------------------------
+    {
+        // there is no layer kept for buttons beyond BTNMATRIX_MAX_BUTTONS
+        if (idx >= m_numKeys || idx >= BTNMATRIX_MAX_BUTTONS)
+        {
+            return BTN_KEY_NONE;
+        }
+
+        // the highest active layer not being transparent for this key
+        const uint16_t active = getActiveLayers();
+        uint8_t layer = m_numLayers;
+        keycode_t code = BTN_KEY_NONE;
+        while (0 < layer)
+        {
+            layer--;
+            if (0 != (active & (1U << layer)))
+            {
+                code = lookup(layer, idx);
+                if (BTN_KEY_TRANSPARENT != code)
+                {
+                    break;
+                }
+            }
+        }
+        if (BTN_KEY_TRANSPARENT == code)
+        {
+            code = BTN_KEY_NONE;
+        }
+
+        const uint8_t shift = (idx & 1) * 4;
+        m_keyLayers[idx / 2] = (m_keyLayers[idx / 2] & ~(0x0F << shift)) | (layer << shift);
+
+        if (BTN_KEY_LAYER_MOMENTARY == (code & 0xFF00))
+        {
+            m_momentaryHolders[code & 0x0F]++;
+            m_momentaryLayers |= 1U << (code & 0x0F);
+        }
+        else if (BTN_KEY_LAYER_TOGGLE == (code & 0xFF00))
+        {
+            m_toggledLayers ^= 1U << (code & 0x0F);
+        }
+
+        return code;
+    }
+
+
+
+    keycode_t Keymap::release(uint16_t idx)
+    //-----------------------------------------------------------------------------
+    {
+        const keycode_t code = getKeyCode(idx);
+
+        // the layer stays active as long as any of its keys is held
+        if (BTN_KEY_LAYER_MOMENTARY == (code & 0xFF00) && 0 < m_momentaryHolders[code & 0x0F]
+            && 0 == --m_momentaryHolders[code & 0x0F])
+        {
+            m_momentaryLayers &= ~(1U << (code & 0x0F));
+        }
+
+        return code;
+    }
+
+
+
+    void Keymap::setLayer(uint8_t layer, bool active)
+    //-----------------------------------------------------------------------------
+    {
+        if (0 < layer && layer < s_maxLayers)
+        {
+            if (active)
+            {
+                m_toggledLayers |= 1U << layer;
+            }
+            else
+            {
+                m_toggledLayers &= ~(1U << layer);
+            }
+        }
+    }
+}
@@ -0,0 +1,164 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         Keymap.h
+  -----------------------------------------------------------------------------
+  @brief        Layered mapping of button indices to application key codes
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef Keymap_h
+#define Keymap_h
+
+#include <Arduino.h>
+#include "ButtonMatrixConfig.h"
+
+
+namespace RSys
+{
+    typedef uint16_t keycode_t;     /** Application key code (i.e. a HID usage ID) */
+
+    /**
+        @brief Key codes with a special meaning for the keymap
+    */
+    enum BTN_KEY_CODE : keycode_t
+    {
+        BTN_KEY_NONE            = 0x0000,   /** No key code */
+        BTN_KEY_LAYER_MOMENTARY = 0xFE00,   /** Layer active while any of its keys is held (use layerMomentary()) */
+        BTN_KEY_LAYER_TOGGLE    = 0xFD00,   /** Layer toggled by each key press (use layerToggle()) */
+        BTN_KEY_TRANSPARENT     = 0xFFFF    /** Use the key code of the next lower active layer */
+    };
+
+    /**
+        @brief  Key code activating a layer while the key is held
+        @param  layer
+                Layer (0...15)
+        @return Key code
+    */
+    constexpr keycode_t layerMomentary(uint8_t layer) { return BTN_KEY_LAYER_MOMENTARY | (layer & 0x0F); }
+
+    /**
+        @brief  Key code toggling a layer by each key press
+        @param  layer
+                Layer (0...15)
+        @return Key code
+    */
+    constexpr keycode_t layerToggle(uint8_t layer) { return BTN_KEY_LAYER_TOGGLE | (layer & 0x0F); }
+
+
+    /**
+        @brief Layered keymap. The key codes are held in a constant table of numLayers * numKeys
+               entries (layer by layer, each layer in button index order), i.e.
+               const keycode_t table[2][ROWS * COLS] PROGMEM = { {...}, {...} };
+               Layer 0 is always active, the highest active layer with a key code other
+               than BTN_KEY_TRANSPARENT determines the key code of a button when it is pressed.
+               The key code is kept until the button is released, so changing the layers
+               while a button is held never changes its key code
+    */
+    class Keymap
+    {
+    public:
+
+        static const uint8_t s_maxLayers = 16;  /** Maximum number of layers */
+
+        /**
+            @brief  c'tor
+            @param  pTable
+                    Key code table (numLayers * numKeys entries, declare it as static constant array)
+            @param  numLayers
+                    Number of layers in the table (up to s_maxLayers)
+            @param  numKeys
+                    Number of keys per layer (number of buttons of the matrix, keys beyond
+                    BTNMATRIX_MAX_BUTTONS are never resolved)
+            @param  inProgmem
+                    True if the table is stored in flash (PROGMEM, AVR only)
+        */
+        Keymap(const keycode_t* pTable, uint8_t numLayers, uint16_t numKeys, bool inProgmem = false);
+
+        /**
+            @brief  Gets the key code of a button as it has been pressed last
+            @param  idx
+                    Index of the button
+            @return Key code (BTN_KEY_NONE if out of range)
+        */
+        keycode_t getKeyCode(uint16_t idx) const;
+
+        /**
+            @brief  Gets the key code of a button within a particular layer
+            @param  layer
+                    Layer
+            @param  idx
+                    Index of the button
+            @return Key code (BTN_KEY_NONE if out of range)
+        */
+        keycode_t lookup(uint8_t layer, uint16_t idx) const;
+
+        /**
+            @brief  Resolves the key code of a pressed button and executes layer keys
+                    (called by the matrix)
+            @param  idx
+                    Index of the button
+            @return Key code
+        */
+        keycode_t press(uint16_t idx);
+
+        /**
+            @brief  Executes the release of layer keys (called by the matrix)
+            @param  idx
+                    Index of the button
+            @return Key code the button has been pressed with
+        */
+        keycode_t release(uint16_t idx);
+
+        /**
+            @brief  Activates or deactivates a layer (like a toggle key)
+            @param  layer
+                    Layer
+            @param  active
+                    True to activate the layer
+        */
+        void setLayer(uint8_t layer, bool active = true);
+
+        /**
+            @brief  Gets the active layers
+            @return Bit mask of the active layers (bit 0 is layer 0)
+        */
+        inline uint16_t getActiveLayers() const { return 0x0001 | m_momentaryLayers | m_toggledLayers; }
+
+        /**
+            @brief  Determines whether or not a layer is active
+            @param  layer
+                    Layer
+            @return True if active
+        */
+        inline bool isLayerActive(uint8_t layer) const { return layer < s_maxLayers && 0 != (getActiveLayers() & (1U << layer)); }
+
+    private:
+
+        const keycode_t* const  m_pTable;       /** Key code table */
+        const uint8_t   m_numLayers;            /** Number of layers in the table */
+        const uint16_t  m_numKeys;              /** Number of keys per layer */
+        const bool      m_inProgmem;            /** Table stored in flash */
+        uint16_t        m_momentaryLayers;      /** Layers activated by held keys */
+        uint8_t         m_momentaryHolders[s_maxLayers];  /** Number of keys holding each momentary layer */
+        uint16_t        m_toggledLayers;        /** Layers activated by toggle keys or setLayer() */
+        uint8_t         m_keyLayers[(BTNMATRIX_MAX_BUTTONS + 1) / 2];  /** Layer each button has been pressed in (4 bits each) */
+    };
+}
+
+
+#endif // Keymap_h
@@ -0,0 +1,98 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ManualClock.h
+  -----------------------------------------------------------------------------
+  @brief        Manually advanced time source (simulation and host testing)
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ManualClock_h
+#define ManualClock_h
+
+#include <Arduino.h>
+#include <ClockItf.h>
+
+
+namespace RSys
+{
+    /**
+        @brief Time source that only moves when told to.
+               Makes simulations deterministic and lets them run faster than real time
+        @implements ClockItf
+    */
+    class ManualClock : public ClockItf
+    {
+    public:
+
+        /**
+            @brief  c'tor
+            @param  startMs
+                    Initial time in ms
+        */
+        ManualClock(unsigned long startMs = 0)
+        :   m_nowMs(startMs),
+            m_nowUs(0)
+        {
+        }
+
+        virtual unsigned long millis()
+        {
+            return m_nowMs;
+        }
+
+        virtual unsigned long micros()
+        {
+            return m_nowMs * 1000UL + m_nowUs;
+        }
+
+        /**
+            @brief  Sets the current time
+            @param  ms
+                    New time in ms
+        */
+        inline void setTime(unsigned long ms) { m_nowMs = ms; m_nowUs = 0; }
+
+        /**
+            @brief  Advances the current time
+            @param  ms
+                    Number of ms to advance
+        */
+        inline void advance(unsigned long ms) { m_nowMs += ms; }
+
+        /**
+            @brief  Advances the current time by microseconds
+            @param  us
+                    Number of us to advance
+        */
+        inline void advanceMicros(unsigned long us)
+        {
+            m_nowUs += us;
+            m_nowMs += m_nowUs / 1000UL;
+            m_nowUs %= 1000UL;
+        }
+
+    private:
+
+        unsigned long m_nowMs;  /** Current time in ms */
+        unsigned long m_nowUs;  /** Microseconds within the current ms */
+    };
+
+}
+
+
+#endif // ManualClock_h
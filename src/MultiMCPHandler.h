@@ -31,12 +31,41 @@
 
 namespace RSys
 {
-    template <class IOHandler, class MCPImpl>
+    /**
+        @brief  Routes virtual pins to multiple MCPs.
+                Each MCP owns a range of IORange virtual pins, so the virtual pin
+                mcpIdx * IORange + pin addresses the physical pin on the MCP with index mcpIdx.
+                The default range of 100 needs BTNMATRIX_WIDE_PINS for more than two MCPs,
+                a range of 16 addresses up to eight MCP23017 (128 IO) with 8 bit pins as well.
+        @tparam IOHandler
+                IO handler implementation used for each MCP
+        @tparam MCPImpl
+                MCP implementation
+        @tparam IORange
+                Virtual pin range per MCP
+        @implements IOHandlerItf
+    */
+    template <class IOHandler, class MCPImpl, uint16_t IORange = 100>
     class MultiMCPHandler : public IOHandlerItf
     {
+        static_assert(IORange > 0 && IORange - 1 <= (pin_t)~(pin_t)0, "IORange exceeds the pin range, define BTNMATRIX_WIDE_PINS");
+
     public:
 
-        virtual void pinMode(uint8_t vPin, uint8_t mode)
+        /**
+            @brief  Gets the virtual pin of a physical pin on a particular MCP
+            @param  mcpIdx
+                    Index of the MCP in the array passed to getInstance()
+            @param  pin
+                    Physical pin on the MCP
+            @return Virtual pin
+        */
+        static inline pin_t toVirtualPin(uint8_t mcpIdx, uint8_t pin)
+        {
+            return (pin_t)(mcpIdx * IORange + pin);
+        }
+
+        virtual void pinMode(pin_t vPin, uint8_t mode)
         {
             IOHandlerItf* pHandler = getHandler(vPin);
             if (NULL != pHandler)
@@ -45,7 +74,7 @@ namespace RSys
             }
         }
 
-        virtual void digitalWrite(uint8_t vPin, uint8_t val)
+        virtual void digitalWrite(pin_t vPin, uint8_t val)
         {
             IOHandlerItf* pHandler = getHandler(vPin);
             if (NULL != pHandler)
@@ -54,7 +83,7 @@ namespace RSys
             }
         }
 
-        virtual int digitalRead(uint8_t vPin)
+        virtual int digitalRead(pin_t vPin)
         {
             int val = LOW;
 
@@ -67,8 +96,133 @@ namespace RSys
             return val;
         }
 
+        /** @brief Sets the mode of the pins of each MCP with a single call of its handler (see IOHandlerItf) */
+        virtual void pinModeMulti(const pin_t* vPins, uint8_t numPins, uint8_t mode)
+        {
+            pin_t pins[BTNMATRIX_MAX_LINES];
+            for (uint16_t idxHandler = 0; idxHandler < m_numHandlers; idxHandler++)
+            {
+                const uint8_t numMcpPins = gatherPins(vPins, numPins, NULL, idxHandler, pins);
+                if (0 < numMcpPins)
+                {
+                    m_pHandlers[idxHandler]->pinModeMulti(pins, numMcpPins, mode);
+                }
+            }
+        }
+
+        /** @brief Writes the pins of each MCP with a single call of its handler (see IOHandlerItf) */
+        virtual void digitalWriteMulti(const pin_t* vPins, uint8_t numPins, uint8_t val)
+        {
+            pin_t pins[BTNMATRIX_MAX_LINES];
+            for (uint16_t idxHandler = 0; idxHandler < m_numHandlers; idxHandler++)
+            {
+                const uint8_t numMcpPins = gatherPins(vPins, numPins, NULL, idxHandler, pins);
+                if (0 < numMcpPins)
+                {
+                    m_pHandlers[idxHandler]->digitalWriteMulti(pins, numMcpPins, val);
+                }
+            }
+        }
+
+        /** @brief Reads the pins of each MCP with a single call of its handler (see IOHandlerItf) */
+        virtual void digitalReadMulti(const pin_t* vPins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+        {
+            pin_t pins[BTNMATRIX_MAX_LINES];
+            uint8_t mcpBits[(BTNMATRIX_MAX_LINES + 7) / 8];
+
+            for (uint8_t idx = 0; idx < (numPins + 7) / 8; idx++)
+            {
+                bits[idx] = 0;
+            }
+
+            for (uint16_t idxHandler = 0; idxHandler < m_numHandlers; idxHandler++)
+            {
+                const uint8_t numMcpPins = gatherPins(vPins, numPins, mask, idxHandler, pins);
+
+                if (0 < numMcpPins)
+                {
+                    m_pHandlers[idxHandler]->digitalReadMulti(pins, numMcpPins, NULL, mcpBits);
+                    scatterBits(vPins, numPins, mask, idxHandler, mcpBits, numMcpPins, bits);
+                }
+            }
+        }
+
+        /**
+            @brief  Drives and reads the pins of the MCP of the drive line with a single call of its handler,
+                    the pins of the other MCPs are read afterwards (see IOHandlerItf)
+        */
+        virtual void driveAndRead(pin_t vDrivePin, uint8_t driveVal, uint16_t settleUs,
+                                  const pin_t* vPins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+        {
+            const uint16_t idxDrive = vDrivePin / IORange;
+            if (idxDrive >= m_numHandlers)
+            {
+                IOHandlerItf::driveAndRead(vDrivePin, driveVal, settleUs, vPins, numPins, mask, bits);
+                return;
+            }
+
+            pin_t pins[BTNMATRIX_MAX_LINES];
+            uint8_t mcpBits[(BTNMATRIX_MAX_LINES + 7) / 8];
+
+            for (uint8_t idx = 0; idx < (numPins + 7) / 8; idx++)
+            {
+                bits[idx] = 0;
+            }
+
+            // the line has settled once the MCP driving it returns, so the other MCPs are just read
+            uint8_t numMcpPins = gatherPins(vPins, numPins, mask, idxDrive, pins);
+            m_pHandlers[idxDrive]->driveAndRead(getPhysicalPin(vDrivePin), driveVal, settleUs, pins, numMcpPins, NULL, mcpBits);
+            scatterBits(vPins, numPins, mask, idxDrive, mcpBits, numMcpPins, bits);
+
+            for (uint16_t idxHandler = 0; idxHandler < m_numHandlers; idxHandler++)
+            {
+                numMcpPins = (idxHandler != idxDrive) ? gatherPins(vPins, numPins, mask, idxHandler, pins) : 0;
+                if (0 < numMcpPins)
+                {
+                    m_pHandlers[idxHandler]->digitalReadMulti(pins, numMcpPins, NULL, mcpBits);
+                    scatterBits(vPins, numPins, mask, idxHandler, mcpBits, numMcpPins, bits);
+                }
+            }
+        }
+
+        /** @brief Invalidates the handlers of all MCPs (see IOHandlerItf) */
+        virtual void invalidate()
+        {
+            for (uint16_t idx = 0; idx < m_numHandlers; idx++)
+            {
+                m_pHandlers[idx]->invalidate();
+            }
+        }
+
+        /**
+            @brief  Determines whether or not the virtual pins of all MCPs fit into pin_t
+                    (numHandlers * IORange must not exceed the pin range, otherwise ButtonMatrix::init() fails)
+            @return True if all MCPs are addressable
+        */
+        virtual bool isValid() const
+        {
+            return (uint32_t)m_numHandlers * IORange <= (uint32_t)(pin_t)~(pin_t)0 + 1;
+        }
+
+        /**
+            @brief  c'tor using caller provided handlers
+                    (declare handlers, array and MultiMCPHandler as static objects to avoid any heap usage)
+            @param  pHandlers
+                    Array of IO handlers, one for each MCP
+            @param  numHandlers
+                    Number of handlers in the array
+        */
+        MultiMCPHandler(IOHandlerItf** pHandlers, const uint8_t numHandlers)
+        :   m_pHandlers(pHandlers),
+            m_numHandlers(numHandlers),
+            m_ownsHandlers(false)
+        {
+        }
+
+#ifndef BTNMATRIX_NO_HEAP
         /**
             @brief  Returns the implementation for an MultiMCPHandler
+                    (handlers are allocated on the heap and never freed)
             @param  mcpImpl
                     Array of MCP instances
             @param  numMCPs
@@ -79,24 +233,31 @@ namespace RSys
         {
             return *(new MultiMCPHandler(mcpImpl, numMCPs));
         }
+#endif
 
         /**
             @brief d'tor
         */
-        ~MultiMCPHandler()
+        virtual ~MultiMCPHandler()
         {
-            for (uint8_t idx = 0; idx < m_numHandlers; idx++)
+#ifndef BTNMATRIX_NO_HEAP
+            if (m_ownsHandlers)
             {
-                delete m_pHandlers[idx];
-                m_pHandlers[idx] = NULL;
+                for (uint8_t idx = 0; idx < m_numHandlers; idx++)
+                {
+                    delete m_pHandlers[idx];
+                    m_pHandlers[idx] = NULL;
+                }
+                delete [] m_pHandlers;
             }
-            delete [] m_pHandlers;
+#endif
             m_pHandlers = NULL;
         }
 
 
     private:
 
+#ifndef BTNMATRIX_NO_HEAP
         /**
             @brief  c'tor
             @param  mcpImpl
@@ -105,7 +266,8 @@ namespace RSys
                     Number of MCP instances in the array
         */
         MultiMCPHandler(MCPImpl* mcpImpl, const uint8_t numMCPs)
-        :    m_numHandlers(numMCPs)
+        :   m_numHandlers(numMCPs),
+            m_ownsHandlers(true)
         {
             m_pHandlers = new IOHandlerItf*[numMCPs];
             for (uint8_t idx = 0; idx < numMCPs; idx++)
@@ -113,6 +275,7 @@ namespace RSys
                 m_pHandlers[idx] = &IOHandler::getInstance(mcpImpl[idx]);
             }
         }
+#endif
 
         /**
             @brief  Returns the handler associated to the virtual pin
@@ -120,29 +283,107 @@ namespace RSys
                     Virtual pin
             @return Pointer to the handler or NULL if out of range
         */
-        IOHandlerItf* getHandler(uint8_t vPin)
+        IOHandlerItf* getHandler(pin_t vPin)
         {
-            const uint8_t idxHandler = vPin / s_HandlerIORange;
+            const uint16_t idxHandler = vPin / IORange;
             IOHandlerItf* pHandler = (idxHandler < m_numHandlers) ? m_pHandlers[idxHandler] : NULL;
             return pHandler;
         }
 
+        /**
+            @brief  Gathers the physical pins of a bulk operation belonging to a particular MCP
+            @param  vPins
+                    Array of virtual pins
+            @param  numPins
+                    Number of pins in the array
+            @param  mask
+                    Packed selection bits (NULL for all)
+            @param  idxHandler
+                    Index of the MCP handler
+            @param  pins
+                    Array receiving the physical pins (BTNMATRIX_MAX_LINES elements)
+            @return Number of physical pins gathered
+        */
+        static uint8_t gatherPins(const pin_t* vPins, uint8_t numPins, const uint8_t* mask,
+                                  uint16_t idxHandler, pin_t* pins)
+        {
+            uint8_t numMcpPins = 0;
+            for (uint8_t idx = 0; idx < numPins && numMcpPins < BTNMATRIX_MAX_LINES; idx++)
+            {
+                if (isRequested(vPins[idx], idxHandler, mask, idx))
+                {
+                    pins[numMcpPins++] = getPhysicalPin(vPins[idx]);
+                }
+            }
+            return numMcpPins;
+        }
+
+        /**
+            @brief  Scatters the states read from a particular MCP to the positions requested
+            @param  vPins
+                    Array of virtual pins
+            @param  numPins
+                    Number of pins in the array
+            @param  mask
+                    Packed selection bits (NULL for all)
+            @param  idxHandler
+                    Index of the MCP handler
+            @param  mcpBits
+                    Packed states of the physical pins gathered by gatherPins()
+            @param  numMcpPins
+                    Number of physical pins gathered
+            @param  bits
+                    Packed bits receiving the states (cleared by the caller)
+        */
+        static void scatterBits(const pin_t* vPins, uint8_t numPins, const uint8_t* mask, uint16_t idxHandler,
+                                const uint8_t* mcpBits, uint8_t numMcpPins, uint8_t* bits)
+        {
+            uint8_t idxMcpPin = 0;
+            for (uint8_t idx = 0; idx < numPins && idxMcpPin < numMcpPins; idx++)
+            {
+                if (isRequested(vPins[idx], idxHandler, mask, idx))
+                {
+                    if (mcpBits[idxMcpPin >> 3] & (1 << (idxMcpPin & 7)))
+                    {
+                        bits[idx >> 3] |= 1 << (idx & 7);
+                    }
+                    idxMcpPin++;
+                }
+            }
+        }
+
+        /**
+            @brief  Checks if a pin of a bulk operation belongs to a particular MCP and is selected by the mask
+            @param  vPin
+                    Virtual pin
+            @param  idxHandler
+                    Index of the MCP handler
+            @param  mask
+                    Packed selection bits (NULL for all)
+            @param  idx
+                    Position of the pin in the bulk read
+            @return True if the pin is to be read from the MCP
+        */
+        static inline bool isRequested(pin_t vPin, uint16_t idxHandler, const uint8_t* mask, uint8_t idx)
+        {
+            return vPin / IORange == idxHandler && (NULL == mask || (mask[idx >> 3] & (1 << (idx & 7))));
+        }
+
         /**
             @brief  Returns the physical pin for the virtual pin given
             @param  vPin
                     Virtual pin
             @return Physical pin
         */
-        inline const uint8_t getPhysicalPin(uint8_t vPin) const
+        static inline pin_t getPhysicalPin(pin_t vPin)
         {
-            return vPin % s_HandlerIORange;
+            return vPin % IORange;
         }
 
 
         IOHandlerItf** m_pHandlers;         /** IOHanlder interface array */
         const uint8_t m_numHandlers;    /** Number of handlers in the array */
-
-        static const uint8_t s_HandlerIORange = 100; /** Virtual pin range per handler */
+        const bool m_ownsHandlers;      /** Handlers have been allocated by getInstance() */
     };
 
 }
@@ -0,0 +1,65 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         NativeClock.h
+  -----------------------------------------------------------------------------
+  @brief        Controller native time source for the ButtonMatrix
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef NativeClock_h
+#define NativeClock_h
+
+#include <Arduino.h>
+#include <ClockItf.h>
+
+
+namespace RSys
+{
+    /**
+        @brief Time source based on the Arduino millis() and micros() functions
+        @implements ClockItf
+    */
+    class NativeClock : public ClockItf
+    {
+    public:
+
+        virtual unsigned long millis()
+        {
+            return ::millis();
+        }
+
+        virtual unsigned long micros()
+        {
+            return ::micros();
+        }
+
+        /**
+            @brief  Returns the default implementation for the native clock
+            @return Reference to the implementation
+        */
+        static inline ClockItf& getDefault()
+        {
+            static NativeClock clock;
+            return clock;
+        }
+    };
+
+}
+
+
+#endif // NativeClock_h
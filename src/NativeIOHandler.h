@@ -38,17 +38,17 @@ namespace RSys
     {
     public:
 
-        virtual void pinMode(uint8_t pin, uint8_t mode)
+        virtual void pinMode(pin_t pin, uint8_t mode)
         {
             ::pinMode(pin, mode);
         }
 
-        virtual void digitalWrite(uint8_t pin, uint8_t val)
+        virtual void digitalWrite(pin_t pin, uint8_t val)
         {
             ::digitalWrite(pin, val);
         }
 
-        virtual int digitalRead(uint8_t pin)
+        virtual int digitalRead(pin_t pin)
         {
             return ::digitalRead(pin);
         }
@@ -0,0 +1,54 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ScanObserverItf.h
+  -----------------------------------------------------------------------------
+  @brief        Interface for observing the raw result of each matrix scan
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ScanObserverItf_h
+#define ScanObserverItf_h
+
+#include <Arduino.h>
+#include "KeySet.h"
+
+
+namespace RSys
+{
+    /**
+        @brief Abstract interface to get notified about each raw matrix scan
+    */
+    class ScanObserverItf
+    {
+    public:
+
+        /**
+            @brief  Called after the matrix has been scanned and before the
+                    buttons are updated
+            @param  raw
+                    Raw (not yet processed) key bitmap, a set bit means pressed
+            @param  now
+                    Timestamp in ms of the scan
+        */
+        virtual void onScan(const KeySet& raw, unsigned long now) = 0;
+    };
+
+}
+
+
+#endif // ScanObserverItf_h
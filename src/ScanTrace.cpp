@@ -0,0 +1,298 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ScanTrace.cpp
+  -----------------------------------------------------------------------------
+  @brief        Recording of raw matrix scans into a compact binary stream
+                and offline replay of such a stream
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#include "ScanTrace.h"
+#include "ButtonMatrix.h"
+
+
+namespace RSys
+{
+
+    // -----------------
+    // ScanTraceRecorder
+    // -----------------
+
+    ScanTraceRecorder::ScanTraceRecorder(uint8_t* buffer, size_t size, KeySet& prev)
+    //-----------------------------------------------------------------------------
+    :   m_pBuffer(buffer),
+        m_size(size),
+        m_pos(0),
+        m_overflow(false),
+        m_prev(prev),
+        m_lastTime(0),
+        m_idleTime(0),
+        m_idleDt(0),
+        m_idleCount(0)
+    {
+        m_prev.clear();
+    }
+
+
+    void ScanTraceRecorder::onScan(const KeySet& raw, unsigned long now)
+    //-----------------------------------------------------------------------------
+    {
+        if (m_overflow)
+        {
+            return;
+        }
+
+        const uint16_t numChanged = raw.countDiff(m_prev);
+
+        if (0 == numChanged)
+        {
+            // nothing changed -> extend the idle run as long as the scan distance stays the same
+            if (m_idleCount > 0 && (now - m_idleTime) != m_idleDt)
+            {
+                flush();
+                if (m_overflow)
+                {
+                    return;
+                }
+            }
+            if (0 == m_idleCount)
+            {
+                m_idleDt = now - m_lastTime;
+            }
+            m_idleCount++;
+            m_idleTime = now;
+        }
+        else
+        {
+            flush();
+            // a lost idle run would shift the time base of every following record
+            if (!m_overflow && writeRecord(now - m_lastTime, (uint32_t)numChanged << 1, &raw))
+            {
+                m_lastTime = now;
+                m_prev = raw;
+            }
+        }
+    }
+
+
+    void ScanTraceRecorder::flush()
+    //-----------------------------------------------------------------------------
+    {
+        if (m_idleCount > 0 && !m_overflow)
+        {
+            if (writeRecord(m_idleDt, (m_idleCount << 1) | 1, NULL))
+            {
+                m_lastTime = m_idleTime;
+            }
+        }
+        m_idleCount = 0;
+    }
+
+
+    void ScanTraceRecorder::reset()
+    //-----------------------------------------------------------------------------
+    {
+        m_pos = 0;
+        m_overflow = false;
+        m_prev.clear();
+        m_lastTime = 0;
+        m_idleTime = 0;
+        m_idleDt = 0;
+        m_idleCount = 0;
+    }
+
+
+    bool ScanTraceRecorder::writeVarint(uint32_t val)
+    //-----------------------------------------------------------------------------
+    {
+        do
+        {
+            if (m_pos >= m_size)
+            {
+                return false;
+            }
+            uint8_t byte = val & 0x7F;
+            val >>= 7;
+            m_pBuffer[m_pos++] = byte | ((0 != val) ? 0x80 : 0x00);
+        } while (0 != val);
+
+        return true;
+    }
+
+
+    bool ScanTraceRecorder::writeRecord(uint32_t dt, uint32_t header, const KeySet* pRaw)
+    //-----------------------------------------------------------------------------
+    {
+        const size_t startPos = m_pos;
+        bool ok = writeVarint(dt) && writeVarint(header);
+
+        if (NULL != pRaw)
+        {
+            // the keys toggled since the previous scan
+            uint16_t expected = 0;
+            for (uint16_t idx = pRaw->findFirstDiff(m_prev); ok && KeySet::npos != idx; idx = pRaw->findNextDiff(m_prev, idx))
+            {
+                ok = writeVarint(idx - expected);
+                expected = idx + 1;
+            }
+        }
+
+        if (!ok)
+        {
+            // never leave a partial record behind
+            m_pos = startPos;
+            m_overflow = true;
+        }
+
+        return ok;
+    }
+
+
+
+    // -----------------
+    // ScanTraceReplayer
+    // -----------------
+
+    ScanTraceReplayer::ScanTraceReplayer(const uint8_t* data, size_t size, KeySet& state)
+    //-----------------------------------------------------------------------------
+    :   m_pData(data),
+        m_size(size),
+        m_pos(0),
+        m_state(state),
+        m_time(0),
+        m_idleDt(0),
+        m_idleCount(0)
+    {
+        m_state.clear();
+    }
+
+
+    void ScanTraceReplayer::rewind()
+    //-----------------------------------------------------------------------------
+    {
+        m_pos = 0;
+        m_state.clear();
+        m_time = 0;
+        m_idleDt = 0;
+        m_idleCount = 0;
+    }
+
+
+    bool ScanTraceReplayer::next(KeySet& raw, unsigned long& now)
+    //-----------------------------------------------------------------------------
+    {
+        if (!step())
+        {
+            return false;
+        }
+
+        raw = m_state;
+        now = m_time;
+        return true;
+    }
+
+
+    bool ScanTraceReplayer::step()
+    //-----------------------------------------------------------------------------
+    {
+        if (m_idleCount > 0)
+        {
+            m_idleCount--;
+            m_time += m_idleDt;
+        }
+        else
+        {
+            uint32_t dt = 0;
+            uint32_t header = 0;
+            if (!readVarint(dt) || !readVarint(header))
+            {
+                return false;
+            }
+
+            if (0x01 == header)
+            {
+                // an idle run without scans is never written
+                return false;
+            }
+
+            m_time += dt;
+            if (0 != (header & 1))
+            {
+                // idle run -> this is the first of its scans
+                m_idleDt = dt;
+                m_idleCount = (header >> 1) - 1;
+            }
+            else
+            {
+                uint32_t expected = 0;
+                for (uint32_t n = header >> 1; n > 0; n--)
+                {
+                    uint32_t gap = 0;
+                    if (!readVarint(gap))
+                    {
+                        return false;
+                    }
+                    const uint16_t idx = expected + gap;
+                    m_state.set(idx, !m_state.test(idx));
+                    expected = idx + 1;
+                }
+            }
+        }
+
+        return true;
+    }
+
+
+    uint32_t ScanTraceReplayer::replay(ButtonMatrix& matrix)
+    //-----------------------------------------------------------------------------
+    {
+        uint32_t numScans = 0;
+
+        // the state is handed over directly, no copy of the bitmap needed
+        while (step())
+        {
+            matrix.processScan(m_state, m_time);
+            numScans++;
+        }
+
+        return numScans;
+    }
+
+
+    bool ScanTraceReplayer::readVarint(uint32_t& val)
+    //-----------------------------------------------------------------------------
+    {
+        val = 0;
+        for (uint8_t shift = 0; shift < 32; shift += 7)
+        {
+            if (m_pos >= m_size)
+            {
+                return false;
+            }
+            const uint8_t byte = m_pData[m_pos++];
+            val |= (uint32_t)(byte & 0x7F) << shift;
+            if (0 == (byte & 0x80))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+}
@@ -0,0 +1,207 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         ScanTrace.h
+  -----------------------------------------------------------------------------
+  @brief        Recording of raw matrix scans into a compact binary stream
+                and offline replay of such a stream
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef ScanTrace_h
+#define ScanTrace_h
+
+#include <Arduino.h>
+#include "ScanObserverItf.h"
+
+
+/**
+    Stream format (all numbers are unsigned LEB128 varints):
+
+        record      := dt header payload
+        dt          := time in ms since the previous scan (first record: since 0)
+        header      := (n << 1)           change record, payload are n key gaps
+                     | (count << 1) | 1   idle run, no payload
+        key gap     := index of the toggled key minus (index of the previous toggled key + 1)
+
+    A change record holds the keys whose raw state differs from the previous scan.
+    An idle run stands for count unchanged scans, each dt ms after the previous one.
+*/
+
+
+namespace RSys
+{
+    class ButtonMatrix;
+
+
+    /**
+        @brief Records raw scans into a caller provided buffer
+               Attach it to a matrix by means of ButtonMatrix::setScanObserver()
+        @implements ScanObserverItf
+    */
+    class ScanTraceRecorder : public ScanObserverItf
+    {
+    public:
+
+        /**
+            @brief  c'tor
+            @param  buffer
+                    Buffer the stream is written to
+            @param  size
+                    Size of the buffer in bytes
+            @param  prev
+                    Set keeping the raw state of the previous scan, sized for the matrix
+                    recorded (e.g. a FixedKeySet, declare it as static object)
+        */
+        ScanTraceRecorder(uint8_t* buffer, size_t size, KeySet& prev);
+
+        /** @brief see ScanObserverItf */
+        virtual void onScan(const KeySet& raw, unsigned long now);
+
+        /**
+            @brief  Writes any pending idle run to the buffer
+                    (call before reading the stream)
+        */
+        void flush();
+
+        /**
+            @brief  Discards the recorded stream and starts over
+        */
+        void reset();
+
+        /**
+            @brief  Gets the number of bytes written to the buffer
+            @return Size of the stream in bytes
+        */
+        inline size_t getSize() const { return m_pos; }
+
+        /**
+            @brief  Determines whether or not recording stopped because the buffer is full
+            @return True, if the buffer has overflowed
+        */
+        inline bool hasOverflowed() const { return m_overflow; }
+
+    private:
+
+        /**
+            @brief  Appends a varint to the buffer
+            @param  val
+                    Value to write
+            @return False if the buffer is full
+        */
+        bool writeVarint(uint32_t val);
+
+        /**
+            @brief  Writes a complete record or nothing at all
+            @param  dt
+                    Time since the previous record
+            @param  header
+                    Record header
+            @param  pRaw
+                    Raw state of the scan for a change record (the keys differing from
+                    the previous scan are written) or NULL for an idle run
+            @return False if the record did not fit into the buffer
+        */
+        bool writeRecord(uint32_t dt, uint32_t header, const KeySet* pRaw);
+
+        uint8_t*        m_pBuffer;      /** Buffer the stream is written to */
+        const size_t    m_size;         /** Size of the buffer */
+        size_t          m_pos;          /** Write position */
+        bool            m_overflow;     /** Buffer has overflowed */
+
+        KeySet&         m_prev;         /** Raw state of the previous scan */
+        unsigned long   m_lastTime;     /** Timestamp of the last written scan */
+        unsigned long   m_idleTime;     /** Timestamp of the last scan of the pending idle run */
+        uint32_t        m_idleDt;       /** Scan distance of the pending idle run */
+        uint32_t        m_idleCount;    /** Number of scans in the pending idle run */
+    };
+
+
+
+    /**
+        @brief Replays a stream written by the ScanTraceRecorder
+    */
+    class ScanTraceReplayer
+    {
+    public:
+
+        /**
+            @brief  c'tor
+            @param  data
+                    Recorded stream
+            @param  size
+                    Size of the stream in bytes
+            @param  state
+                    Set keeping the raw state of the current scan, sized for the matrix
+                    replayed (e.g. a FixedKeySet, declare it as static object)
+        */
+        ScanTraceReplayer(const uint8_t* data, size_t size, KeySet& state);
+
+        /**
+            @brief  Restarts the replay from the beginning of the stream
+        */
+        void rewind();
+
+        /**
+            @brief  Gets the next scan of the stream
+            @param  raw
+                    Reference receiving the raw key bitmap of the scan
+            @param  now
+                    Reference receiving the timestamp of the scan
+            @return False if the end of the stream has been reached
+        */
+        bool next(KeySet& raw, unsigned long& now);
+
+        /**
+            @brief  Feeds all remaining scans of the stream through the matrix
+                    (no IO is involved, so this runs as fast as the processing allows)
+            @param  matrix
+                    Matrix to process the scans
+            @return Number of scans replayed
+        */
+        uint32_t replay(ButtonMatrix& matrix);
+
+    private:
+
+        /**
+            @brief  Advances the current state by the next scan of the stream
+            @return False if the end of the stream has been reached
+        */
+        bool step();
+
+        /**
+            @brief  Reads a varint from the stream
+            @param  val
+                    Reference receiving the value
+            @return False if the stream is exhausted or corrupt
+        */
+        bool readVarint(uint32_t& val);
+
+        const uint8_t*  m_pData;        /** Recorded stream */
+        const size_t    m_size;         /** Size of the stream */
+        size_t          m_pos;          /** Read position */
+
+        KeySet&         m_state;        /** Raw state of the current scan */
+        unsigned long   m_time;         /** Timestamp of the current scan */
+        uint32_t        m_idleDt;       /** Scan distance of the current idle run */
+        uint32_t        m_idleCount;    /** Remaining scans of the current idle run */
+    };
+
+}
+
+
+#endif // ScanTrace_h
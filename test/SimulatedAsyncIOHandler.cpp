@@ -0,0 +1,130 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         SimulatedAsyncIOHandler.cpp
+  -----------------------------------------------------------------------------
+  @brief        Asynchronous IO simulation handler with delayed completion
+                (required for unit testing)
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+
+#include "SimulatedAsyncIOHandler.h"
+
+
+
+SimulatedAsyncIOHandler::SimulatedAsyncIOHandler(RSys::IOHandlerItf& ioHandler, uint8_t numPolls)
+//-----------------------------------------------------------------------------
+:   m_ioHandler(ioHandler),
+    m_numPolls(numPolls),
+    m_transfer(TRANSFER_NONE),
+    m_pollsLeft(0),
+    m_numPollCalls(0),
+    m_drivePin(0),
+    m_driveVal(HIGH),
+    m_pins(NULL),
+    m_numPins(0),
+    m_hasMask(false)
+{
+}
+
+
+void SimulatedAsyncIOHandler::pinMode(RSys::pin_t pin, uint8_t mode)
+//-----------------------------------------------------------------------------
+{
+    m_ioHandler.pinMode(pin, mode);
+}
+
+
+void SimulatedAsyncIOHandler::digitalWrite(RSys::pin_t pin, uint8_t val)
+//-----------------------------------------------------------------------------
+{
+    m_ioHandler.digitalWrite(pin, val);
+}
+
+
+int SimulatedAsyncIOHandler::digitalRead(RSys::pin_t pin)
+//-----------------------------------------------------------------------------
+{
+    return m_ioHandler.digitalRead(pin);
+}
+
+
+bool SimulatedAsyncIOHandler::startDriveAndRead(
+                                RSys::pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                                const RSys::pin_t* pins, uint8_t numPins, const uint8_t* mask)
+//-----------------------------------------------------------------------------
+{
+    (void)settleUs;
+    bool started = TRANSFER_NONE == m_transfer;
+    if (started)
+    {
+        m_transfer = TRANSFER_DRIVE_AND_READ;
+        m_pollsLeft = m_numPolls;
+        m_drivePin = drivePin;
+        m_driveVal = driveVal;
+        m_pins = pins;
+        m_numPins = numPins;
+        m_hasMask = NULL != mask;
+        for (uint8_t idx = 0; m_hasMask && idx < (numPins + 7) / 8; idx++)
+        {
+            m_mask[idx] = mask[idx];
+        }
+    }
+
+    return started;
+}
+
+
+bool SimulatedAsyncIOHandler::startDigitalWrite(RSys::pin_t pin, uint8_t val)
+//-----------------------------------------------------------------------------
+{
+    bool started = TRANSFER_NONE == m_transfer;
+    if (started)
+    {
+        m_transfer = TRANSFER_WRITE;
+        m_pollsLeft = m_numPolls;
+        m_drivePin = pin;
+        m_driveVal = val;
+    }
+
+    return started;
+}
+
+
+bool SimulatedAsyncIOHandler::poll(uint8_t* bits)
+//-----------------------------------------------------------------------------
+{
+    m_numPollCalls++;
+
+    if (0 < m_pollsLeft)
+    {
+        m_pollsLeft--;
+    }
+    else if (TRANSFER_DRIVE_AND_READ == m_transfer)
+    {
+        m_ioHandler.driveAndRead(m_drivePin, m_driveVal, 0, m_pins, m_numPins, m_hasMask ? m_mask : NULL, bits);
+        m_transfer = TRANSFER_NONE;
+    }
+    else if (TRANSFER_WRITE == m_transfer)
+    {
+        m_ioHandler.digitalWrite(m_drivePin, m_driveVal);
+        m_transfer = TRANSFER_NONE;
+    }
+
+    return TRANSFER_NONE == m_transfer;
+}
@@ -0,0 +1,86 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         SimulatedAsyncIOHandler.h
+  -----------------------------------------------------------------------------
+  @brief        Asynchronous IO simulation handler with delayed completion
+                (required for unit testing)
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#include <AsyncIOHandlerItf.h>
+
+
+/**
+    @brief Simulates an IO expander whose transfers complete after a number of polls.
+           The transfers are executed by a synchronous IO handler on completion
+*/
+class SimulatedAsyncIOHandler : public RSys::AsyncIOHandlerItf
+{
+public:
+
+    /**
+        @brief  c'tor
+        @param  ioHandler
+                Synchronous IO handler executing the transfers
+        @param  numPolls
+                Number of polls a transfer takes to complete
+    */
+    SimulatedAsyncIOHandler(RSys::IOHandlerItf& ioHandler, uint8_t numPolls);
+
+    /** @brief see IOHandlerItf */
+    virtual void pinMode(RSys::pin_t pin, uint8_t mode);
+    /** @brief see IOHandlerItf */
+    virtual void digitalWrite(RSys::pin_t pin, uint8_t val);
+    /** @brief see IOHandlerItf */
+    virtual int digitalRead(RSys::pin_t pin);
+
+    /** @brief see AsyncIOHandlerItf */
+    virtual bool startDriveAndRead(RSys::pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                                   const RSys::pin_t* pins, uint8_t numPins, const uint8_t* mask);
+    /** @brief see AsyncIOHandlerItf */
+    virtual bool startDigitalWrite(RSys::pin_t pin, uint8_t val);
+    /** @brief see AsyncIOHandlerItf */
+    virtual bool poll(uint8_t* bits);
+
+    /** @brief Gets the number of polls since construction */
+    inline uint32_t getNumPolls() const { return m_numPollCalls; }
+
+private:
+
+    /** @brief Pending transfer */
+    enum TRANSFER : unsigned char
+    {
+        TRANSFER_NONE,
+        TRANSFER_DRIVE_AND_READ,
+        TRANSFER_WRITE
+    };
+
+    RSys::IOHandlerItf& m_ioHandler;    /** Synchronous IO handler */
+    const uint8_t   m_numPolls;         /** Number of polls a transfer takes */
+
+    TRANSFER        m_transfer;         /** Pending transfer */
+    uint8_t         m_pollsLeft;        /** Polls left until the pending transfer completes */
+    uint32_t        m_numPollCalls;     /** Number of polls */
+
+    RSys::pin_t     m_drivePin;         /** Output pin of the pending transfer */
+    uint8_t         m_driveVal;         /** Output value of the pending transfer */
+    const RSys::pin_t* m_pins;          /** Pins to be read by the pending transfer */
+    uint8_t         m_numPins;          /** Number of pins to be read */
+    uint8_t         m_mask[(BTNMATRIX_MAX_LINES + 7) / 8];  /** Read mask of the pending transfer */
+    bool            m_hasMask;          /** m_mask is valid */
+};
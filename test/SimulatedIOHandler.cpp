@@ -26,46 +26,65 @@
 
 
 
-void SimulatedIOHandler::pinMode(uint8_t pin, uint8_t mode)
+void SimulatedIOHandler::pinMode(RSys::pin_t pin, uint8_t mode)
 //-----------------------------------------------------------------------------
 {
-    
+    (void)pin;
+    (void)mode;
+    m_numPinModes++;
 }
 
 
-void SimulatedIOHandler::digitalWrite(uint8_t pin, uint8_t val)
+void SimulatedIOHandler::digitalWrite(RSys::pin_t pin, uint8_t val)
 //-----------------------------------------------------------------------------
 {
-    uint8_t col = 0;
-    if (getColFromPin(pin, col))
+    m_numWrites++;
+
+    uint8_t line = 0;
+    if (getColFromPin(pin, line))
+    {
+        m_ioStates[line] = val;
+    }
+    else if (getRowFromPin(pin, line))
     {
-        m_pIoStates[col] = val;
+        m_rowStates[line] = val;
     }
 }
 
 
-int SimulatedIOHandler::digitalRead(uint8_t pin)
+int SimulatedIOHandler::digitalRead(RSys::pin_t pin)
 //-----------------------------------------------------------------------------
 {
+    m_numReads++;
+
     int val = HIGH;
     uint8_t row = 0;
+    uint8_t col = 0;
 
     if (getRowFromPin(pin, row))
-    {        
-        uint8_t col = 0;
+    {
         if (getLowCol(col))
         {
-            val =  (RSys::BTN_STATE_RELEASED == m_pButtonStates[row * m_numCols + col])
+            val =  (RSys::BTN_STATE_RELEASED == m_buttonStates[row * m_numCols + col])
                     ? HIGH
                     : LOW;
         }
+        else
+        {
+            val = m_rowStates[row];
+        }
     }
-    else
+    else if (getColFromPin(pin, col))
     {
-        uint8_t col = 0;
-        if (getColFromPin(pin, col))
+        if (getLowRow(row))
         {
-            val = m_pIoStates[col];
+            val =  (RSys::BTN_STATE_RELEASED == m_buttonStates[row * m_numCols + col])
+                    ? HIGH
+                    : LOW;
+        }
+        else
+        {
+            val = m_ioStates[col];
         }
     }
 
@@ -73,70 +92,124 @@ int SimulatedIOHandler::digitalRead(uint8_t pin)
 }
 
 
+void SimulatedIOHandler::driveAndRead(
+                                RSys::pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                                const RSys::pin_t* pins, uint8_t numPins, const uint8_t* mask, uint8_t* bits)
+//-----------------------------------------------------------------------------
+{
+    m_lastSettleTime = settleUs;
+    if (NULL != m_pLineClock)
+    {
+        m_pLineClock->advanceMicros(m_lineTime);
+    }
+
+    // no delay required for the simulation
+    IOHandlerItf::driveAndRead(drivePin, driveVal, 0, pins, numPins, mask, bits);
+    for (uint8_t idx = 0; idx < (numPins + 7) / 8 && idx < sizeof(m_residualLow); idx++)
+    {
+        const uint8_t lows = ((NULL != mask) ? mask[idx] : 0xFF) & ~bits[idx];
+        if (settleUs < m_settleTime)
+        {
+            // lines pulled LOW through a closed key of the line driven before have not recovered yet
+            bits[idx] &= ~m_residualLow[idx];
+        }
+        m_residualLow[idx] = lows;
+    }
+}
+
+
 void SimulatedIOHandler::simButtonState(
                                     uint8_t row, uint8_t col,
                                     RSys::BTN_STATE state)
 //-----------------------------------------------------------------------------
 {
-    m_pButtonStates[row * m_numCols + col] = state;
+    const uint16_t idx = row * m_numCols + col;
+    if (idx < s_maxButtons)
+    {
+        m_buttonStates[idx] = state;
+    }
+}
+
+
+void SimulatedIOHandler::resetCounters()
+//-----------------------------------------------------------------------------
+{
+    m_numPinModes = 0;
+    m_numWrites = 0;
+    m_numReads = 0;
 }
 
 
 SimulatedIOHandler::SimulatedIOHandler(
-                                uint8_t* rowPins, uint8_t* colPins,
+                                RSys::pin_t* rowPins, RSys::pin_t* colPins,
                                 uint8_t numRows, uint8_t numCols)
 //-----------------------------------------------------------------------------
 :   m_rowPins(rowPins),
     m_colPins(colPins),
-    m_numRows(numRows),
-    m_numCols(numCols),
-    m_pIoStates(NULL),
-    m_pButtonStates(NULL)
-{    
-    m_pIoStates = new int[numCols];
-    m_pButtonStates = new RSys::BTN_STATE[numRows*numCols];
-    for (uint8_t idx = 0; idx < numRows*numCols; idx++)
+    m_numRows((numRows < s_maxCols) ? numRows : s_maxCols),
+    m_numCols((numCols < s_maxCols) ? numCols : s_maxCols),
+    m_settleTime(0),
+    m_lastSettleTime(0),
+    m_residualLow(),
+    m_pLineClock(NULL),
+    m_lineTime(0),
+    m_numPinModes(0),
+    m_numWrites(0),
+    m_numReads(0)
+{
+    for (uint16_t idx = 0; idx < s_maxButtons; idx++)
     {
-        m_pButtonStates[idx] = RSys::BTN_STATE_RELEASED;
+        m_buttonStates[idx] = RSys::BTN_STATE_RELEASED;
     }
 
     for (uint8_t idx = 0; idx < m_numCols; idx++)
     {
-        m_pIoStates[idx] = HIGH;
+        m_ioStates[idx] = HIGH;
+    }
+
+    for (uint8_t idx = 0; idx < m_numRows; idx++)
+    {
+        m_rowStates[idx] = HIGH;
     }
 }
 
 
 
-SimulatedIOHandler::~SimulatedIOHandler()
+bool SimulatedIOHandler::getLowCol(uint8_t& col) const
 //-----------------------------------------------------------------------------
 {
-    delete [] m_pButtonStates;
-    m_pButtonStates = NULL;
+    bool found = false;
+
+    col = 0;
+    do
+    {
+        found = LOW == m_ioStates[col];
+        if (!found) col++;
+    } while (!found && col < m_numCols);
 
-    delete [] m_pIoStates;
-    m_pIoStates = NULL;
+    return found;
 }
 
 
-bool SimulatedIOHandler::getLowCol(uint8_t& col) const
+
+bool SimulatedIOHandler::getLowRow(uint8_t& row) const
 //-----------------------------------------------------------------------------
 {
     bool found = false;
 
-    col = 0;
+    row = 0;
     do
     {
-        found = LOW == m_pIoStates[col];
-        if (!found) col++;
-    } while (!found && col < m_numCols);
+        found = LOW == m_rowStates[row];
+        if (!found) row++;
+    } while (!found && row < m_numRows);
 
     return found;
 }
 
 
 
-bool SimulatedIOHandler::getRowFromPin(uint8_t pin, uint8_t& row) const
+bool SimulatedIOHandler::getRowFromPin(RSys::pin_t pin, uint8_t& row) const
 //-----------------------------------------------------------------------------
 {
     bool found = false;
@@ -152,7 +225,7 @@ bool SimulatedIOHandler::getRowFromPin(uint8_t pin, uint8_t& row) const
 }
 
 
-bool SimulatedIOHandler::getColFromPin(uint8_t pin, uint8_t& col) const
+bool SimulatedIOHandler::getColFromPin(RSys::pin_t pin, uint8_t& col) const
 //-----------------------------------------------------------------------------
 {
     bool found = false;
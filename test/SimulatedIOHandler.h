@@ -23,6 +23,7 @@
 
 #include <IOHandlerItf.h>
 #include <Button.h>
+#include <ManualClock.h>
 
 
 /**
@@ -34,11 +35,14 @@ class SimulatedIOHandler : public RSys::IOHandlerItf
 public:
 
     /** @brief see IOHandlerItf */
-    virtual void pinMode(uint8_t pin, uint8_t mode);
+    virtual void pinMode(RSys::pin_t pin, uint8_t mode);
     /** @brief see IOHandlerItf */
-    virtual void digitalWrite(uint8_t pin, uint8_t val);
+    virtual void digitalWrite(RSys::pin_t pin, uint8_t val);
     /** @brief see IOHandlerItf */
-    virtual int digitalRead(uint8_t pin);
+    virtual int digitalRead(RSys::pin_t pin);
+    /** @brief see IOHandlerItf (lines LOW during the previous call stay LOW if the settle time is too short) */
+    virtual void driveAndRead(RSys::pin_t drivePin, uint8_t driveVal, uint16_t settleUs,
+                              const RSys::pin_t* pins, uint8_t numPins, const uint8_t* mask, uint8_t* bits);
 
     /**
         @brief  Simulate a button state
@@ -52,44 +56,54 @@ public:
     void simButtonState(uint8_t row, uint8_t col, RSys::BTN_STATE state);
 
     /**
-        @brief  Get the IO simulator instance (singleton)
-        @param  rowPins
-                Array of row pins
-        @param  colPins
-                Array of column pins
-        @param  numRows
-                Number of rows in the matrix
-        @param  numCols
-                Number of columns in the matrix
+        @brief  Simulate the settle time of the lines. Read lines pulled LOW by a closed key
+                recover slowly, so they still read LOW on the next drive line (ghost keys)
+                if the settle time passed is shorter
+        @param  us
+                Minimum settle time in microseconds required for correct reads
     */
-    static inline SimulatedIOHandler& getInstance(
-                                    uint8_t* rowPins, uint8_t* colPins,
-                                    uint8_t numRows, uint8_t numCols)
-    {            
-        return *(new SimulatedIOHandler(rowPins, colPins, numRows, numCols));
-    }
+    inline void simSettleTime(uint16_t us) { m_settleTime = us; }
 
-private:
+    /**
+        @brief  Simulate the time it takes to drive and sample a line
+        @param  pClock
+                Clock advanced by each driveAndRead() call (NULL to stop advancing)
+        @param  us
+                Time per line in microseconds
+    */
+    inline void simLineTime(RSys::ManualClock* pClock, uint16_t us) { m_pLineClock = pClock; m_lineTime = us; }
+
+    /** @brief Gets the settle time passed by the last driveAndRead() call */
+    inline uint16_t getLastSettleTime() const { return m_lastSettleTime; }
+
+    /** @brief Resets the IO operation counters */
+    void resetCounters();
+
+    /** @brief Gets the number of pinMode() calls since the last resetCounters() */
+    inline uint32_t getNumPinModes() const { return m_numPinModes; }
+
+    /** @brief Gets the number of digitalWrite() calls since the last resetCounters() */
+    inline uint32_t getNumWrites() const { return m_numWrites; }
+
+    /** @brief Gets the number of digitalRead() calls since the last resetCounters() */
+    inline uint32_t getNumReads() const { return m_numReads; }
 
     /**
-        @brief  c'tor
+        @brief  c'tor (declare each simulator as static object, one per simulated matrix)
         @param  rowPins
                 Array of row pins
         @param  colPins
                 Array of column pins
         @param  numRows
-                Number of rows in the matrix
+                Number of rows in the matrix (limited by s_maxCols)
         @param  numCols
-                Number of columns in the matrix
-    */ 
+                Number of columns in the matrix (limited by s_maxCols)
+    */
     SimulatedIOHandler(
-                    uint8_t* rowPins, uint8_t* colPins,
+                    RSys::pin_t* rowPins, RSys::pin_t* colPins,
                     uint8_t numRows, uint8_t numCols);
 
-    /**
-        @brief  d'tor
-    */ 
-    virtual ~SimulatedIOHandler();
+private:
 
     /**
         @brief  Gets the first column that output pin is in LOW state
@@ -101,6 +115,15 @@ private:
     */ 
     bool getLowCol(uint8_t& col) const;
 
+    /**
+        @brief  Gets the first row that output pin is in LOW state
+        @param  row
+                Reference to the row number whose output pin is in LOW state
+                (only valid if the method returns true)
+        @return True if a row has been found, else false
+    */
+    bool getLowRow(uint8_t& row) const;
+
     /**
         @brief  Get the row number the pin is belonging to
         @param  pin
@@ -110,7 +133,7 @@ private:
                 (only valid if the method returns true)
         @return True if the pin belongs to a row, else false
     */    
-    bool getRowFromPin(uint8_t pin, uint8_t& row) const;
+    bool getRowFromPin(RSys::pin_t pin, uint8_t& row) const;
 
     /**
         @brief  Get the column number the pin is belonging to
@@ -121,15 +144,29 @@ private:
                 (only valid if the method returns true)
         @return True if the pin belongs to a column, else false
     */     
-    bool getColFromPin(uint8_t pin, uint8_t& col) const;
+    bool getColFromPin(RSys::pin_t pin, uint8_t& col) const;
 
     
 
-    const uint8_t*  m_rowPins;      /** Array of row pins */
-    const uint8_t*  m_colPins;      /** Array of column pins */
+    const RSys::pin_t* m_rowPins;      /** Array of row pins */
+    const RSys::pin_t* m_colPins;      /** Array of column pins */
     const uint8_t   m_numRows;      /** Number of rows in the matrix */
     const uint8_t   m_numCols;      /** Number of columns in the matrix */
 
-    int* m_pIoStates;                       /** Array of IO states (one for each column pin) */
-    RSys::BTN_STATE* m_pButtonStates;   /** Array of button state (one for each button) */
+    static const uint8_t s_maxCols = 64;    /** Maximum number of simulated columns (and rows) */
+    static const uint16_t s_maxButtons = s_maxCols * s_maxCols;    /** Maximum number of simulated buttons */
+
+    int m_ioStates[s_maxCols];                                 /** Array of IO states (one for each column pin) */
+    int m_rowStates[s_maxCols];                                /** Array of IO states (one for each row pin) */
+
+    uint16_t m_settleTime;      /** Simulated minimum settle time in microseconds */
+    uint16_t m_lastSettleTime;  /** Settle time passed by the last driveAndRead() call */
+    uint8_t m_residualLow[(s_maxCols + 7) / 8];   /** Read lines LOW during the last driveAndRead() call */
+    RSys::ManualClock* m_pLineClock;    /** Clock advanced by each driveAndRead() call */
+    uint16_t m_lineTime;        /** Simulated time per line in microseconds */
+
+    uint32_t m_numPinModes;     /** Number of pinMode() calls */
+    uint32_t m_numWrites;       /** Number of digitalWrite() calls */
+    uint32_t m_numReads;        /** Number of digitalRead() calls */
+    RSys::BTN_STATE m_buttonStates[s_maxButtons];             /** Array of button state (one for each button) */
 };
\ No newline at end of file
@@ -0,0 +1,161 @@
+/**
+  *****************************************************************************
+  Module        ButtonMatrix
+  @file         SimulatedMCP.h
+  -----------------------------------------------------------------------------
+  @brief        MCP23017 simulation counting the I2C transactions (required for unit testing)
+  -----------------------------------------------------------------------------
+  @author       Rene Richter
+  @date         18.10.2026
+  @modified     -
+  @copyright    (c) 2023-2026 Rene Richter
+  @license      This library is free software; you can redistribute it and/or
+                modify it under the terms of the GNU Lesser General Public
+                License as published by the Free Software Foundation; version
+                2.1 of the License.
+
+                This library is distributed in the hope that it will be useful,
+                but WITHOUT ANY WARRANTY; without even the implied warranty of
+                MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+                See the GNU Lesser General Public License for more details.
+  *****************************************************************************
+*/
+
+#ifndef SimulatedMCP_h
+#define SimulatedMCP_h
+
+#include <Arduino.h>
+
+
+/**
+    @brief Provides the interface of the Adafruit MCP23X17 class used by the AdafruitI2CIOHandler.
+           Closed keys connect two pins, an input pin reads LOW while it is connected
+           to an output pin with a LOW output latch. Each register access counts as a transaction
+           (the single pin operations of the Adafruit library read and write the register)
+*/
+class SimulatedMCP
+{
+public:
+
+    /**
+        @brief  c'tor (all pins inputs, all output latches HIGH, no keys closed)
+    */
+    SimulatedMCP()
+    :   m_outputs(0),
+        m_latch(0xFFFF),
+        m_numTransactions(0),
+        m_numPortReads(0)
+    {
+        for (uint8_t idx = 0; idx < 16; idx++)
+        {
+            m_links[idx] = 0;
+        }
+    }
+
+    /** @brief Sets the direction of a pin (IODIR read and write) */
+    void pinMode(uint8_t pin, uint8_t mode)
+    {
+        const uint16_t bit = 1u << pin;
+        m_outputs = (OUTPUT == mode) ? (m_outputs | bit) : (m_outputs & ~bit);
+        m_numTransactions += 2;
+    }
+
+    /** @brief Sets the output latch of a pin (GPIO read and write) */
+    void digitalWrite(uint8_t pin, uint8_t val)
+    {
+        const uint16_t bit = 1u << pin;
+        m_latch = (LOW == val) ? (m_latch & ~bit) : (m_latch | bit);
+        m_numTransactions += 2;
+    }
+
+    /** @brief Reads a pin (GPIO read) */
+    int digitalRead(uint8_t pin)
+    {
+        m_numTransactions++;
+        return (getLevels() & (1u << pin)) ? HIGH : LOW;
+    }
+
+    /** @brief Reads both ports (GPIO read) */
+    uint16_t readGPIOAB()
+    {
+        m_numTransactions++;
+        m_numPortReads++;
+        return getLevels();
+    }
+
+    /** @brief Writes the output latches of both ports (GPIO write) */
+    void writeGPIOAB(uint16_t val)
+    {
+        m_latch = val;
+        m_numTransactions++;
+    }
+
+    /**
+        @brief  Simulate a key connecting two pins
+        @param  pinA
+                First pin
+        @param  pinB
+                Second pin
+        @param  closed
+                True if the key is pressed
+    */
+    void simKey(uint8_t pinA, uint8_t pinB, bool closed)
+    {
+        const uint16_t bitA = 1u << pinA;
+        const uint16_t bitB = 1u << pinB;
+        m_links[pinA] = closed ? (m_links[pinA] | bitB) : (m_links[pinA] & ~bitB);
+        m_links[pinB] = closed ? (m_links[pinB] | bitA) : (m_links[pinB] & ~bitA);
+    }
+
+    /**
+        @brief  Simulate a power on reset (all pins inputs, all output latches LOW)
+    */
+    void simReset()
+    {
+        m_outputs = 0;
+        m_latch = 0;
+    }
+
+    /** @brief Gets the number of I2C transactions since the last reset */
+    inline uint16_t getNumTransactions() const { return m_numTransactions; }
+
+    /** @brief Gets the number of port reads since the last reset */
+    inline uint16_t getNumPortReads() const { return m_numPortReads; }
+
+    /** @brief Resets the transaction counters */
+    inline void resetTransactions() { m_numTransactions = 0; m_numPortReads = 0; }
+
+private:
+
+    /**
+        @brief  Gets the levels of all pins
+        @return Levels (port B in the upper byte)
+    */
+    uint16_t getLevels() const
+    {
+        uint16_t levels = 0xFFFF;
+        for (uint8_t idx = 0; idx < 16; idx++)
+        {
+            const uint16_t bit = 1u << idx;
+            if (0 != (m_outputs & bit))
+            {
+                levels = (0 != (m_latch & bit)) ? levels : (levels & ~bit);
+            }
+            else if (0 != (m_links[idx] & m_outputs & ~m_latch))
+            {
+                levels &= ~bit;
+            }
+        }
+        return levels;
+    }
+
+
+    uint16_t    m_links[16];        /** Pins connected to each pin by closed keys */
+    uint16_t    m_outputs;          /** Pins configured as output */
+    uint16_t    m_latch;            /** Output latches */
+    uint16_t    m_numTransactions;  /** I2C transactions since the last reset */
+    uint16_t    m_numPortReads;     /** Port reads since the last reset */
+};
+
+
+#endif // SimulatedMCP_h
@@ -25,7 +25,17 @@
 #include <unity.h>
 
 #include <ButtonMatrix.h>
+#include <ManualClock.h>
+#include <ScanTrace.h>
+#include <ButtonMatrixGroup.h>
+#include <ButtonEventStream.h>
+#include <Keymap.h>
+#include <HIDReportBuilder.h>
 #include "SimulatedIOHandler.h"
+#include "SimulatedAsyncIOHandler.h"
+#include "SimulatedMCP.h"
+#include <AdafruitI2CIOHandler.h>
+#include <MultiMCPHandler.h>
 
 using namespace RSys;
 
@@ -33,14 +43,16 @@ using namespace RSys;
 /** Forward declarations for event handlers */
 void event_Button_State_changed(Button&);
 void event_Button_Action(Button&);
+void event_Button_Batch(void*, const ButtonEvent*, uint8_t);
+void event_Button_Subscription(void*, const ButtonEvent&);
 
 
 
 const uint8_t COLS = 3; /** Number of button matrix columns */
 const uint8_t ROWS = 3; /** Number of button matrix rows */
 
-uint8_t colPins[COLS] = {4,5,6}; /** Button matrix column pins */
-uint8_t rowPins[ROWS] = {0,1,2}; /** Button matrix row pins */
+pin_t colPins[COLS] = {4,5,6}; /** Button matrix column pins */
+pin_t rowPins[ROWS] = {0,1,2}; /** Button matrix row pins */
 
 
 /** @brief Button matrix button definitons */
@@ -52,15 +64,105 @@ Button buttons[ROWS][COLS] =
 };
 
 /** @brief IO simulator */
-SimulatedIOHandler& simIO = SimulatedIOHandler::getInstance(rowPins, colPins, ROWS, COLS);
+SimulatedIOHandler simIO(rowPins, colPins, ROWS, COLS);
 
 /** @brief Button matrix */
 ButtonMatrix matrix((Button*)buttons, rowPins, colPins, ROWS, COLS, simIO);
 
+/** @brief Memory of the button matrix */
+MatrixMemory<ROWS, COLS> matrixMemory;
+
+
+/** @brief Manually advanced clock for deterministic timing tests */
+ManualClock simClock;
+
+/** @brief Button definitions for the matrix driven by the manual clock */
+Button clkButtons[ROWS][COLS] =
+{
+    { (1), (2), (3) },
+    { (4), (5), (6) },
+    { (7), (8), (9) }
+};
+
+/** @brief Button matrix driven by the manual clock (sharing the IO simulator) */
+ButtonMatrix clkMatrix((Button*)clkButtons, rowPins, colPins, ROWS, COLS, simIO, simClock);
+MatrixMemory<ROWS, COLS> clkMemory;   /** Memory of the manual clock matrix */
+
+/** @brief Button definitions for the matrix fed by a replayed scan trace */
+Button replayButtons[ROWS][COLS] =
+{
+    { (1), (2), (3) },
+    { (4), (5), (6) },
+    { (7), (8), (9) }
+};
+
+/** @brief Button matrix fed by a replayed scan trace (never scanned itself) */
+ButtonMatrix replayMatrix((Button*)replayButtons, rowPins, colPins, ROWS, COLS, simIO, simClock);
+MatrixMemory<ROWS, COLS> replayMemory;   /** Memory of the replay matrix */
+
+/** @brief Compact button state store */
+CompactButtons<ROWS * COLS> compactButtons;
+
+/** @brief Button matrix keeping its state in the compact store */
+ButtonMatrix compactMatrix(compactButtons, rowPins, colPins, ROWS, COLS, simIO, simClock);
+MatrixMemory<ROWS, COLS> compactMemory;   /** Memory of the compact store matrix */
+
+/** @brief Asynchronous IO simulator completing each transfer after two polls */
+SimulatedAsyncIOHandler simAsyncIO(simIO, 2);
+
+/** @brief Compact button state store of the asynchronously scanned matrix */
+CompactButtons<ROWS * COLS> asyncButtons;
+
+/** @brief Button matrix scanned asynchronously */
+ButtonMatrix asyncMatrix(asyncButtons, rowPins, colPins, ROWS, COLS, simAsyncIO, simClock);
+MatrixMemory<ROWS, COLS> asyncMemory;   /** Memory of the asynchronously scanned matrix */
+
+/** @brief Simulated MCP23017s */
+SimulatedMCP simMCPs[2];
+
+/** @brief IO handlers of the simulated MCPs */
+AdafruitI2CIOHandler<SimulatedMCP> mcpIO0(simMCPs[0]);
+AdafruitI2CIOHandler<SimulatedMCP> mcpIO1(simMCPs[1]);
+IOHandlerItf* mcpHandlers[] = { &mcpIO0, &mcpIO1 };
+
+/** @brief IO handler routing virtual pins to the simulated MCPs (16 pins each) */
+MultiMCPHandler<AdafruitI2CIOHandler<SimulatedMCP>, SimulatedMCP, 16> multiIO(mcpHandlers, 2);
+
+pin_t mcpColPins[COLS] = {0,1,2};       /** Column pins of the matrix on the first MCP */
+pin_t mcpRowPins[ROWS] = {8,9,10};      /** Row pins of the matrix on the first MCP */
+
+/** @brief Compact button state store of the matrix connected to the MCPs */
+CompactButtons<ROWS * COLS> mcpButtons;
+
+/** @brief Button matrix connected to the MCPs */
+ButtonMatrix mcpMatrix(mcpButtons, mcpRowPins, mcpColPins, ROWS, COLS, multiIO, simClock);
+MatrixMemory<ROWS, COLS> mcpMemory;   /** Memory of the MCP matrix */
+
+const uint8_t LARGE_ROWS = 20;   /** Number of rows of the large matrix */
+const uint8_t LARGE_COLS = 20;   /** Number of columns of the large matrix */
+
+pin_t largeColPins[LARGE_COLS] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19};             /** Column pins of the large matrix */
+pin_t largeRowPins[LARGE_ROWS] = {20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39};  /** Row pins of the large matrix */
+
+/** @brief IO simulator of the large matrix */
+SimulatedIOHandler largeIO(largeRowPins, largeColPins, LARGE_ROWS, LARGE_COLS);
+
+/** @brief Compact button state store of the large matrix */
+CompactButtons<LARGE_ROWS * LARGE_COLS> largeButtons;
+
+/** @brief Button matrix with more buttons than a byte can number */
+ButtonMatrix largeMatrix(largeButtons, largeRowPins, largeColPins, LARGE_ROWS, LARGE_COLS, largeIO, simClock);
+MatrixMemory<LARGE_ROWS, LARGE_COLS> largeMemory;   /** Memory of the large matrix */
+
 
 /** Global button pointer for event testing */
 Button* pButton = NULL;   
 
+/** Batched events received for event testing */
+ButtonEvent batchEvents[ROWS * COLS];
+uint8_t numBatchEvents = 0;
+uint8_t numBatchCalls = 0;
+
 
 
 /** @brief Runs before each test */
@@ -255,6 +357,39 @@ void test_skipped_rose_after_button_long_press()
 }
 
 
+/** @brief Test if only the changed buttons are reported */
+void test_changed_keys()
+//-----------------------------------------------------------------------------
+{
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    simIO.simButtonState(2, 2, BTN_STATE_PRESSED);
+    TEST_ASSERT_TRUE_MESSAGE(matrix.update(), "Matrix did not signal a change");
+
+    const KeySet& changed = matrix.getChangedKeys();
+    TEST_ASSERT_TRUE_MESSAGE(2 == changed.count(), "Number of changed buttons does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == changed.findFirst(), "First changed button does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(8 == changed.findNext(1), "Second changed button does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(KeySet::npos == changed.findNext(8), "Unexpected changed button!");
+    TEST_ASSERT_TRUE_MESSAGE(matrix.anyFell() && !matrix.anyRose(), "Fell/rose summary does not match!");
+
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == matrix.getRoseKeys().findFirst() && 1 == changed.count(), "Released button not reported!");
+    TEST_ASSERT_TRUE_MESSAGE(!matrix.anyFell() && matrix.anyRose(), "Fell/rose summary does not match!");
+
+    simIO.simButtonState(2, 2, BTN_STATE_RELEASED);
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(8 == changed.findFirst(), "Released button not reported!");
+    TEST_ASSERT_FALSE_MESSAGE(matrix.getPressedKeys().any(), "Buttons still reported as pressed!");
+
+    // consume the pending events
+    for (uint16_t idx = 0; idx < matrix.getNumButtons(); idx++)
+    {
+        matrix.getButton(idx)->hasStateChanged();
+    }
+}
+
+
 /** @brief Test if button state change events work properly */
 void test_button_state_events()
 //-----------------------------------------------------------------------------
@@ -414,6 +549,1177 @@ void test_button_action_skipped_event_after_longpress()
 }
 
 
+/** @brief Test if the matrix strictly follows an injected clock */
+void test_manual_clock()
+//-----------------------------------------------------------------------------
+{
+    clkMatrix.setScanInterval(20);
+    clkMatrix.setMinLongPressDuration(1000);
+    simClock.advance(20);
+
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    TEST_ASSERT_TRUE_MESSAGE(clkMatrix.update(), "Matrix did not signal a change");
+
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simClock.advance(19);
+    TEST_ASSERT_FALSE_MESSAGE(clkMatrix.update(), "Matrix has updated although scan interval has not yet elapsed!");
+
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    Button* pBut = clkMatrix.getButton(1, 1);
+    TEST_ASSERT_TRUE_MESSAGE(pBut->getCurStateDuration(clkMatrix.getClock().millis()) == 19, "Duration does not follow the clock!");
+    TEST_ASSERT_TRUE_MESSAGE(pBut->getCurStateDuration(clkMatrix.getClock()) == 19, "Duration does not follow the clock passed!");
+
+    simClock.advance(980);
+    TEST_ASSERT_FALSE_MESSAGE(pBut->isLongPressed(1000, simClock.millis()), "Long press detected earlier than expected!");
+    simClock.advance(1);
+    TEST_ASSERT_TRUE_MESSAGE(pBut->isLongPressed(1000, simClock.millis()), "Long press not detected!");
+
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(pBut->getPrevStateDuration() == 1020, "Previous state duration does not follow the clock!");
+}
+
+
+/** @brief Test if a recorded scan trace replays to the same button states */
+void test_scan_trace_replay()
+//-----------------------------------------------------------------------------
+{
+    uint8_t traceBuf[64];
+    FixedKeySet<ROWS * COLS> prev;
+    ScanTraceRecorder recorder(traceBuf, sizeof(traceBuf), prev);
+
+    clkMatrix.setScanInterval(20);
+    clkMatrix.setScanObserver(&recorder);
+
+    const uint8_t presses[][2] = { {0, 2}, {2, 0}, {2, 2} };
+    for (uint8_t step = 0; step < 3; step++)
+    {
+        simIO.simButtonState(presses[step][0], presses[step][1], BTN_STATE_PRESSED);
+        for (uint8_t scan = 0; scan < 10; scan++)
+        {
+            simClock.advance(20);
+            clkMatrix.update();
+        }
+        simIO.simButtonState(presses[step][0], presses[step][1], BTN_STATE_RELEASED);
+        simClock.advance(20);
+        clkMatrix.update();
+    }
+
+    clkMatrix.setScanObserver(NULL);
+    recorder.flush();
+    TEST_ASSERT_FALSE_MESSAGE(recorder.hasOverflowed(), "Trace buffer overflowed!");
+
+    FixedKeySet<ROWS * COLS> state;
+    ScanTraceReplayer replayer(traceBuf, recorder.getSize(), state);
+    TEST_ASSERT_TRUE_MESSAGE(33 == replayer.replay(replayMatrix), "Number of replayed scans does not match!");
+
+    for (uint8_t step = 0; step < 3; step++)
+    {
+        Button* pRec = clkMatrix.getButton(presses[step][0], presses[step][1]);
+        Button* pRep = replayMatrix.getButton(presses[step][0], presses[step][1]);
+        TEST_ASSERT_TRUE_MESSAGE(pRec->getCurState() == pRep->getCurState(), "Replayed state does not match!");
+        TEST_ASSERT_TRUE_MESSAGE(pRec->getPrevStateDuration() == pRep->getPrevStateDuration(), "Replayed duration does not match!");
+    }
+}
+
+
+/** @brief Test if recording stops at a full trace buffer until it is reset */
+void test_scan_trace_overflow()
+//-----------------------------------------------------------------------------
+{
+    uint8_t traceBuf[6];
+    FixedKeySet<ROWS * COLS> prev;
+    ScanTraceRecorder recorder(traceBuf, sizeof(traceBuf), prev);
+    FixedKeySet<ROWS * COLS> raw;
+
+    raw.set(3);
+    recorder.onScan(raw, 20);
+    TEST_ASSERT_TRUE_MESSAGE(3 == recorder.getSize(), "Change record size does not match!");
+
+    // the idle run (3 byte count) does not fit, the following change record (3 bytes) would
+    for (uint16_t scan = 0; scan < 10000; scan++)
+    {
+        recorder.onScan(raw, 20);
+    }
+    raw.reset(3);
+    recorder.onScan(raw, 20);
+    TEST_ASSERT_TRUE_MESSAGE(recorder.hasOverflowed(), "Overflow not detected!");
+    TEST_ASSERT_TRUE_MESSAGE(3 == recorder.getSize(), "Record written after the overflow!");
+
+    raw.set(3);
+    recorder.onScan(raw, 40);
+    recorder.flush();
+    TEST_ASSERT_TRUE_MESSAGE(3 == recorder.getSize(), "Recording continued after the overflow!");
+
+    FixedKeySet<ROWS * COLS> state;
+    ScanTraceReplayer replayer(traceBuf, recorder.getSize(), state);
+    unsigned long time = 0;
+    TEST_ASSERT_TRUE_MESSAGE(replayer.next(raw, time), "Recorded scan not replayed!");
+    TEST_ASSERT_TRUE_MESSAGE(20 == time && raw.test(3), "Replayed scan does not match!");
+    TEST_ASSERT_FALSE_MESSAGE(replayer.next(raw, time), "Unexpected scan replayed!");
+
+    recorder.reset();
+    TEST_ASSERT_FALSE_MESSAGE(recorder.hasOverflowed(), "Overflow not reset!");
+    raw.clear();
+    raw.set(3);
+    recorder.onScan(raw, 20);
+    TEST_ASSERT_TRUE_MESSAGE(3 == recorder.getSize(), "Recording not resumed after reset!");
+}
+
+
+/** @brief Test if the compact button store reports the same as buttons */
+void test_compact_store()
+//-----------------------------------------------------------------------------
+{
+    compactMatrix.setScanInterval(0);
+    TEST_ASSERT_NULL_MESSAGE(compactMatrix.getButton(0), "Compact matrix must not hand out buttons!");
+
+    ButtonView view = compactMatrix.getButtonView(2, 1);
+    TEST_ASSERT_TRUE_MESSAGE(BTN_STATE_UNINITIALIZED == view.getPrevState(), "Previous state should not be initialized yet!");
+
+    simIO.simButtonState(2, 1, BTN_STATE_PRESSED);
+    TEST_ASSERT_TRUE_MESSAGE(compactMatrix.update(), "Matrix did not signal a change");
+    TEST_ASSERT_TRUE_MESSAGE(view.isPressed(), "Button press not detected!");
+    TEST_ASSERT_TRUE_MESSAGE(view.fell(), "Button fell not detected!");
+    TEST_ASSERT_FALSE_MESSAGE(view.fell(), "Fell has not been reset!");
+
+    simClock.advance(999);
+    TEST_ASSERT_FALSE_MESSAGE(view.isLongPressed(1000, simClock.millis()), "Long press detected earlier than expected!");
+    TEST_ASSERT_TRUE_MESSAGE(999 == view.getCurStateDuration(simClock.millis()), "Duration does not follow the clock!");
+    TEST_ASSERT_FALSE_MESSAGE(view.isLongPressed(1000), "Long press without timestamp does not follow the matrix clock!");
+    TEST_ASSERT_TRUE_MESSAGE(999 == view.getCurStateDuration(), "Duration without timestamp does not follow the matrix clock!");
+
+    simClock.advance(1);
+    simIO.simButtonState(2, 1, BTN_STATE_RELEASED);
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(view.rose(), "Button released not detected!");
+    TEST_ASSERT_TRUE_MESSAGE(BTN_STATE_PRESSED == view.getPrevState(), "Previous state is not PRESSED!");
+    TEST_ASSERT_TRUE_MESSAGE(view.getPrevStateDuration() >= 900 && view.getPrevStateDuration() <= 1100, "Previous state duration out of tolerance!");
+
+    TEST_ASSERT_FALSE_MESSAGE(compactMatrix.getButtonView(ROWS * COLS).isPressed(), "Button out of range reports pressed!");
+
+    // the repeat is kept within the two action bits of the store
+    compactButtons.updateAction(0, BTN_ACTION_REPEAT);
+    TEST_ASSERT_TRUE_MESSAGE(BTN_ACTION_REPEAT == compactMatrix.getButtonView(0).getLastAction(), "Stored repeat does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(BTN_ACTION_NONE == compactMatrix.getButtonView(0).getLastAction(), "Stored action not reset!");
+}
+
+
+/** @brief Test if a matrix beyond 256 buttons gets memory of its size */
+void test_large_matrix()
+//-----------------------------------------------------------------------------
+{
+#ifdef BTNMATRIX_NO_HEAP
+    TEST_ASSERT_FALSE_MESSAGE(largeMatrix.init(), "Initialization succeeded without memory!");
+    TEST_ASSERT_TRUE_MESSAGE(largeMatrix.setMemory(largeMemory), "Memory not accepted!");
+#endif
+    TEST_ASSERT_TRUE_MESSAGE(largeMatrix.init(), "Large matrix initialization failed!");
+    largeMatrix.setScanInterval(0);
+
+    ButtonView view = largeMatrix.getButtonView(LARGE_ROWS - 1, LARGE_COLS - 1);
+    largeIO.simButtonState(LARGE_ROWS - 1, LARGE_COLS - 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    TEST_ASSERT_TRUE_MESSAGE(largeMatrix.update(), "Matrix did not signal a change");
+    TEST_ASSERT_TRUE_MESSAGE(view.isPressed() && view.fell(), "Button press not detected!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == largeMatrix.getPressedKeys().count()
+                             && largeMatrix.getPressedKeys().test(LARGE_ROWS * LARGE_COLS - 1),
+                             "Pressed keys do not match!");
+
+    largeIO.simButtonState(LARGE_ROWS - 1, LARGE_COLS - 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    largeMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(view.rose(), "Button release not detected!");
+}
+
+
+/** @brief Test if all timestamps of a large store are aged within the window at a slow scan rate */
+void test_compact_store_aging()
+//-----------------------------------------------------------------------------
+{
+    // one scan per second covers far fewer buttons than the store holds within the window
+    ButtonView view = largeMatrix.getButtonView(LARGE_ROWS - 1, LARGE_COLS - 1);
+    largeMatrix.setScanInterval(1000);
+    for (uint8_t scan = 0; scan < 70; scan++)
+    {
+        simClock.advance(1000);
+        largeMatrix.update();
+    }
+    TEST_ASSERT_TRUE_MESSAGE(view.getCurStateDuration() >= (32768UL << BTNMATRIX_COMPACT_TICK_SHIFT),
+                             "Idle duration wrapped around!");
+    largeMatrix.setScanInterval(0);
+}
+
+
+/** @brief Test if all changes of a scan are delivered in a single batch */
+void test_button_batch_events()
+//-----------------------------------------------------------------------------
+{
+    numBatchEvents = numBatchCalls = 0;
+#ifdef BTNMATRIX_NO_HEAP
+    static ButtonEvent events[ROWS * COLS];
+    matrix.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls, events, ROWS * COLS);
+#else
+    matrix.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls);
+#endif
+
+    for (uint8_t col = 0; col < COLS; col++)
+    {
+        simIO.simButtonState(1, col, BTN_STATE_PRESSED);
+    }
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchCalls, "Batch callback not called exactly once!");
+    TEST_ASSERT_TRUE_MESSAGE(3 == numBatchEvents, "Number of batched events does not match!");
+    for (uint8_t evt = 0; evt < numBatchEvents; evt++)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(3 + evt == batchEvents[evt].idx, "Event index does not match!");
+        TEST_ASSERT_TRUE_MESSAGE(BTN_STATE_PRESSED == batchEvents[evt].state, "Event state is not PRESSED!");
+        TEST_ASSERT_TRUE_MESSAGE(BTN_ACTION_NONE == batchEvents[evt].action, "Unexpected event action!");
+    }
+
+    numBatchEvents = numBatchCalls = 0;
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == numBatchCalls, "Batch callback called without changes!");
+
+    for (uint8_t col = 0; col < COLS; col++)
+    {
+        simIO.simButtonState(1, col, BTN_STATE_RELEASED);
+    }
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchCalls && 3 == numBatchEvents, "Released buttons not batched!");
+    TEST_ASSERT_TRUE_MESSAGE(BTN_STATE_RELEASED == batchEvents[0].state, "Event state is not RELEASED!");
+    TEST_ASSERT_TRUE_MESSAGE(BTN_ACTION_CLICK == batchEvents[0].action, "Click action not batched!");
+
+    matrix.registerButtonBatchCallback(NULL);
+}
+
+
+/** @brief Test if subscriptions are only notified for their buttons and event kinds */
+void test_button_subscriptions()
+//-----------------------------------------------------------------------------
+{
+    numBatchEvents = 0;
+    FixedKeySet<ROWS * COLS> keys;
+    keys.set(4);
+    ButtonSubscription sub(event_Button_Subscription, BTN_EVENT_FELL | BTN_EVENT_CLICK, &numBatchCalls);
+    sub.setKeys(&keys);
+    matrix.subscribe(sub);
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents, "Subscription not notified exactly once!");
+    TEST_ASSERT_TRUE_MESSAGE(4 == batchEvents[0].idx && BTN_STATE_PRESSED == batchEvents[0].state, "Fell event does not match!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numBatchEvents, "Subscription not notified exactly once!");
+    TEST_ASSERT_TRUE_MESSAGE(4 == batchEvents[1].idx && BTN_ACTION_CLICK == batchEvents[1].action, "Click event does not match!");
+
+    matrix.unsubscribe(sub);
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    matrix.update();
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numBatchEvents, "Subscription notified after unsubscribe!");
+}
+
+
+/** @brief Test if unpopulated and disabled positions are excluded from the scan */
+void test_scan_mask()
+//-----------------------------------------------------------------------------
+{
+    matrix.setKeyPopulated(0, 0, false);
+    matrix.setButtonEnabled(1, false);
+    FixedKeySet<ROWS * COLS> scanned;
+    matrix.getScannedKeys(scanned);
+    TEST_ASSERT_FALSE_MESSAGE(scanned.test(0), "Unpopulated position is scanned!");
+    TEST_ASSERT_FALSE_MESSAGE(scanned.test(1), "Disabled button is scanned!");
+    TEST_ASSERT_TRUE_MESSAGE(ROWS * COLS - 2 == scanned.count(), "Number of scanned positions does not match!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    matrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(matrix.getPressedKeys().any(), "Excluded position reported as pressed!");
+
+    matrix.setButtonEnabled(1, true);
+    matrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(matrix.getFellKeys().test(1), "Re-enabled button not scanned!");
+    TEST_ASSERT_FALSE_MESSAGE(matrix.getPressedKeys().test(0), "Unpopulated position reported as pressed!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    matrix.setKeyPopulated(0, 0);
+    matrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(matrix.getPressedKeys().any(), "Buttons not released!");
+}
+
+
+/** @brief Test if the matrix scans in both orientations and picks the smaller dimension to be driven */
+void test_scan_orientation()
+//-----------------------------------------------------------------------------
+{
+    compactMatrix.setScanOrientation(SCAN_DRIVE_ROWS);
+    compactMatrix.init();
+    TEST_ASSERT_TRUE_MESSAGE(SCAN_DRIVE_ROWS == compactMatrix.getScanOrientation(), "Rows are not driven!");
+
+    simIO.simButtonState(1, 2, BTN_STATE_PRESSED);
+    simIO.simButtonState(2, 0, BTN_STATE_PRESSED);
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == compactMatrix.getPressedKeys().count(), "Number of pressed buttons does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(compactMatrix.getButtonView(1, 2).isPressed(), "Button press not detected!");
+    TEST_ASSERT_TRUE_MESSAGE(compactMatrix.getButtonView(2, 0).isPressed(), "Button press not detected!");
+
+    // column 2 unpopulated: 3 rows vs. 2 columns to be driven
+    for (uint8_t row = 0; row < ROWS; row++)
+    {
+        compactMatrix.setKeyPopulated(row, 2, false);
+    }
+    compactMatrix.setScanOrientation(SCAN_AUTO);
+    compactMatrix.init();
+    TEST_ASSERT_TRUE_MESSAGE(SCAN_DRIVE_COLS == compactMatrix.getScanOrientation(), "Smaller dimension is not driven!");
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(compactMatrix.getButtonView(2, 0).isPressed(), "Button press not detected!");
+    TEST_ASSERT_FALSE_MESSAGE(compactMatrix.getButtonView(1, 2).isPressed(), "Unpopulated button reported as pressed!");
+
+    // diodes restrict the orientation
+    compactMatrix.setScanOrientation(SCAN_AUTO, DIODES_COL2ROW);
+    TEST_ASSERT_TRUE_MESSAGE(SCAN_DRIVE_ROWS == compactMatrix.getScanOrientation(), "Diode direction not respected!");
+
+    simIO.simButtonState(1, 2, BTN_STATE_RELEASED);
+    simIO.simButtonState(2, 0, BTN_STATE_RELEASED);
+    for (uint8_t row = 0; row < ROWS; row++)
+    {
+        compactMatrix.setKeyPopulated(row, 2);
+    }
+    compactMatrix.setScanOrientation(SCAN_DRIVE_COLS);
+    compactMatrix.init();
+    compactMatrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(compactMatrix.getPressedKeys().any(), "Buttons not released!");
+}
+
+
+/** @brief Test if push-pull drive mode scans without switching the pin modes */
+void test_drive_mode_push_pull()
+//-----------------------------------------------------------------------------
+{
+    compactMatrix.setDriveMode(DRIVE_PUSH_PULL);
+    compactMatrix.init();
+
+    simIO.resetCounters();
+    simIO.simButtonState(0, 2, BTN_STATE_PRESSED);
+    simIO.simButtonState(1, 2, BTN_STATE_PRESSED);
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == simIO.getNumPinModes(), "Pin modes switched in push-pull mode!");
+    TEST_ASSERT_TRUE_MESSAGE(2 * COLS == simIO.getNumWrites(), "Number of writes does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(2 == compactMatrix.getPressedKeys().count(), "Buttons in the same column not detected!");
+
+    simIO.simButtonState(0, 2, BTN_STATE_RELEASED);
+    simIO.simButtonState(1, 2, BTN_STATE_RELEASED);
+    compactMatrix.setDriveMode(DRIVE_TRISTATE);
+    compactMatrix.init();
+
+    simIO.resetCounters();
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 * COLS == simIO.getNumPinModes(), "Pin modes not switched in tristate mode!");
+    TEST_ASSERT_FALSE_MESSAGE(compactMatrix.getPressedKeys().any(), "Buttons not released!");
+}
+
+
+/** @brief Test the fused drive and read operation of the IO handler */
+void test_drive_and_read()
+//-----------------------------------------------------------------------------
+{
+    uint8_t bits = 0;
+    uint8_t mask = 0x05;
+
+    simIO.simButtonState(2, 1, BTN_STATE_PRESSED);
+    simIO.driveAndRead(colPins[1], LOW, 0, rowPins, ROWS, NULL, &bits);
+    TEST_ASSERT_TRUE_MESSAGE(0x03 == bits, "Read lines do not match!");
+
+    simIO.resetCounters();
+    simIO.driveAndRead(colPins[1], LOW, 0, rowPins, ROWS, &mask, &bits);
+    TEST_ASSERT_TRUE_MESSAGE(2 == simIO.getNumReads(), "Masked read line has been read!");
+    TEST_ASSERT_TRUE_MESSAGE(0x01 == (bits & mask), "Masked read lines do not match!");
+
+    simIO.digitalWrite(colPins[1], HIGH);
+    simIO.simButtonState(2, 1, BTN_STATE_RELEASED);
+    simIO.digitalReadMulti(rowPins, ROWS, NULL, &bits);
+    TEST_ASSERT_TRUE_MESSAGE(0x07 == bits, "Released read lines do not match!");
+}
+
+
+/** @brief Test the I2C transactions of the fused drive and read operation of the MCP handlers */
+void test_mcp_drive_and_read()
+//-----------------------------------------------------------------------------
+{
+    const pin_t readPins[2] = {9, 16 + 9};    // same pin on both MCPs
+    uint8_t bits = 0;
+
+    mcpIO0.pinModeMulti(mcpRowPins, ROWS, INPUT_PULLUP);
+    mcpIO0.pinModeMulti(mcpColPins, COLS, OUTPUT);
+    simMCPs[0].simKey(1, 9, true);
+
+    // single pin write (register read and write), port read and release of the line
+    simMCPs[0].resetTransactions();
+    mcpIO0.IOHandlerItf::driveAndRead(1, LOW, 0, mcpRowPins, ROWS, NULL, &bits);
+    mcpIO0.digitalWrite(1, HIGH);
+    TEST_ASSERT_TRUE_MESSAGE(0x05 == bits, "Read lines do not match!");
+    TEST_ASSERT_TRUE_MESSAGE(5 == simMCPs[0].getNumTransactions(), "Unexpected transactions of the single pin operations!");
+
+    // shared MCP: the latch is read before each write, outputs written bypassing the handler are kept
+    simMCPs[0].pinMode(15, OUTPUT);
+    simMCPs[0].digitalWrite(15, LOW);
+    simMCPs[0].resetTransactions();
+    mcpIO0.driveAndRead(1, LOW, 0, mcpRowPins, ROWS, NULL, &bits);
+    TEST_ASSERT_TRUE_MESSAGE(0x05 == bits, "Shared read lines do not match!");
+    TEST_ASSERT_TRUE_MESSAGE(3 == simMCPs[0].getNumTransactions(), "Latch not read before the write!");
+    simMCPs[0].digitalWrite(15, HIGH);
+    mcpIO0.digitalWriteMulti(mcpColPins, COLS, HIGH);
+    TEST_ASSERT_TRUE_MESSAGE(HIGH == simMCPs[0].digitalRead(15), "Output of another user overwritten!");
+    simMCPs[0].pinMode(15, INPUT);
+
+    // exclusive MCP: the cached output latch is written once and the ports are read once
+    mcpIO0.setExclusive(true);
+    mcpIO1.setExclusive(true);
+    mcpIO0.digitalWriteMulti(mcpColPins, COLS, HIGH);
+    simMCPs[0].resetTransactions();
+    mcpIO0.driveAndRead(1, LOW, 0, mcpRowPins, ROWS, NULL, &bits);
+    mcpIO0.digitalWrite(1, HIGH);
+    TEST_ASSERT_TRUE_MESSAGE(0x05 == bits, "Fused read lines do not match!");
+    TEST_ASSERT_TRUE_MESSAGE(3 == simMCPs[0].getNumTransactions(), "Line not driven and read by single transactions!");
+
+    // the MCP of the drive line drives and reads in one call, the other one is just read
+    simMCPs[1].resetTransactions();
+    simMCPs[0].resetTransactions();
+    multiIO.driveAndRead(1, LOW, 0, readPins, 2, NULL, &bits);
+    multiIO.digitalWrite(1, HIGH);
+    TEST_ASSERT_TRUE_MESSAGE(0x02 == bits, "Read lines of both MCPs do not match!");
+    TEST_ASSERT_TRUE_MESSAGE(3 == simMCPs[0].getNumTransactions(), "Drive line MCP not accessed by single transactions!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == simMCPs[1].getNumTransactions(), "Other MCP not read by a single transaction!");
+
+    // full scan in push-pull mode: three transactions per drive line
+    mcpMatrix.setDriveMode(DRIVE_PUSH_PULL);
+    mcpMatrix.init();
+    simMCPs[0].resetTransactions();
+    simClock.advance(20);
+    mcpMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(3 * COLS == simMCPs[0].getNumTransactions(), "Scan not fused per drive line!");
+    TEST_ASSERT_TRUE_MESSAGE(mcpMatrix.getPressedKeys().test(1 * COLS + 1) && 1 == mcpMatrix.getPressedKeys().count(),
+                             "Pressed key not scanned through the MCP!");
+
+    simMCPs[0].simKey(1, 9, false);
+
+    // three MCPs with the default range of 100 virtual pins exceed 8 bit pins -> init() fails
+    static IOHandlerItf* threeHandlers[] = { &mcpIO0, &mcpIO1, &mcpIO0 };
+    static MultiMCPHandler<AdafruitI2CIOHandler<SimulatedMCP>, SimulatedMCP> wideIO(threeHandlers, 3);
+    static CompactButtons<ROWS * COLS> wideButtons;
+    static ButtonMatrix wideMatrix(wideButtons, mcpRowPins, mcpColPins, ROWS, COLS, wideIO, simClock);
+    static MatrixMemory<ROWS, COLS> wideMemory;
+    wideMatrix.setMemory(wideMemory);
+#ifdef BTNMATRIX_WIDE_PINS
+    TEST_ASSERT_TRUE_MESSAGE(wideIO.isValid() && wideMatrix.init(), "Wide virtual pins rejected!");
+#else
+    TEST_ASSERT_TRUE_MESSAGE(!wideIO.isValid() && !wideMatrix.init(), "Virtual pins beyond the pin range accepted!");
+#endif
+    TEST_ASSERT_TRUE_MESSAGE(multiIO.isValid(), "Virtual pins of two MCPs rejected!");
+}
+
+
+/** @brief Test if the calibrated settle time is used by the scan */
+void test_settle_time_calibration()
+//-----------------------------------------------------------------------------
+{
+    // reference button in the first column -> the row recovers too slowly for the second column
+    simIO.simSettleTime(13);
+    simIO.simButtonState(1, 0, BTN_STATE_PRESSED);
+    compactMatrix.setSettleTime(0);
+    simClock.advance(20);
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(compactMatrix.getPressedKeys().test(4), "Ghost of an unsettled line not simulated!");
+
+    TEST_ASSERT_TRUE_MESSAGE(13 == compactMatrix.calibrateSettleTime(3, 100), "Calibrated settle time does not match!");
+    simClock.advance(20);
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(13 == simIO.getLastSettleTime(), "Settle time not passed to the IO handler!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == compactMatrix.getPressedKeys().count(), "Ghost still read!");
+
+    TEST_ASSERT_TRUE_MESSAGE(13 == compactMatrix.calibrateSettleTime(5, 100), "Settle time changed without reference!");
+
+    simIO.simSettleTime(0);
+    TEST_ASSERT_TRUE_MESSAGE(0 == compactMatrix.calibrateSettleTime(3, 100), "Settle time not reduced!");
+
+    simIO.simButtonState(1, 0, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    compactMatrix.update();
+}
+
+
+/** @brief Test if the pins are reconfigured without losing the button states */
+void test_reinit()
+//-----------------------------------------------------------------------------
+{
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    compactMatrix.update();
+
+    simIO.resetCounters();
+    compactMatrix.reinit();
+    TEST_ASSERT_TRUE_MESSAGE(ROWS + COLS == simIO.getNumPinModes(), "Number of pin modes does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(COLS == simIO.getNumWrites(), "Number of writes does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == simIO.getNumReads(), "Pins read during reinit!");
+
+    compactMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(compactMatrix.getButtonView(0, 1).isPressed(), "Button state lost!");
+    TEST_ASSERT_FALSE_MESSAGE(compactMatrix.getChangedKeys().any(), "Button changed by reinit!");
+
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    compactMatrix.update();
+
+    // the latch cached by the exclusive MCP handler is read again after the MCP has been reset
+    simMCPs[0].simKey(1, 9, true);
+    simMCPs[0].simReset();
+    simMCPs[0].resetTransactions();
+    mcpMatrix.reinit();
+    TEST_ASSERT_TRUE_MESSAGE(1 == simMCPs[0].getNumPortReads(), "Cached latch reused after the reset!");
+
+    simClock.advance(20);
+    mcpMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(mcpMatrix.getPressedKeys().test(1 * COLS + 1) && 1 == mcpMatrix.getPressedKeys().count(),
+                             "Pressed key not scanned after the reset!");
+    simMCPs[0].simKey(1, 9, false);
+    simClock.advance(20);
+    mcpMatrix.update();
+}
+
+
+/** @brief Test if the time to the next update covers scans and long presses between the scans */
+void test_time_to_next_update()
+//-----------------------------------------------------------------------------
+{
+    clkMatrix.setScanInterval(300);
+    clkMatrix.setMinLongPressDuration(500);
+    simClock.advance(300);
+
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(300 == clkMatrix.getTimeToNextUpdate(), "Next scan not reported!");
+    simClock.advance(100);
+    TEST_ASSERT_TRUE_MESSAGE(200 == clkMatrix.getTimeToNextUpdate(), "Time to next scan does not follow the clock!");
+
+    simClock.advance(200);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(200 == clkMatrix.getTimeToNextUpdate(), "Long press deadline not reported!");
+
+    numBatchEvents = numBatchCalls = 0;
+    clkMatrix.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls);
+    simClock.advance(200);
+    simIO.resetCounters();
+    TEST_ASSERT_FALSE_MESSAGE(clkMatrix.update(), "Deadline reported a state change!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == simIO.getNumReads(), "Deadline caused a scan!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents, "Long press not processed between the scans!");
+    TEST_ASSERT_TRUE_MESSAGE(4 == batchEvents[0].idx && BTN_ACTION_LONG_PRESS == batchEvents[0].action, "Long press event does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(100 == clkMatrix.getTimeToNextUpdate(), "Processed deadline still reported!");
+
+    clkMatrix.registerButtonBatchCallback(NULL);
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simClock.advance(100);
+    clkMatrix.update();
+    clkMatrix.setScanInterval(20);
+    clkMatrix.setMinLongPressDuration(1000);
+}
+
+
+/** @brief Test if priority buttons are scanned between the regular scans */
+void test_priority_keys()
+//-----------------------------------------------------------------------------
+{
+    static FixedKeySet<ROWS * COLS> priority;
+    priority.set(4);
+    clkMatrix.setScanInterval(100);
+    clkMatrix.setPriorityKeys(&priority, 5);
+    simClock.advance(100);
+    clkMatrix.update();
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    TEST_ASSERT_TRUE_MESSAGE(5 == clkMatrix.getTimeToNextUpdate(), "Priority scan not reported!");
+    simClock.advance(5);
+    simIO.resetCounters();
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(ROWS == simIO.getNumReads(), "More than the priority column has been read!");
+    TEST_ASSERT_TRUE_MESSAGE(clkMatrix.getFellKeys().test(4), "Priority button not detected!");
+    TEST_ASSERT_FALSE_MESSAGE(clkMatrix.getPressedKeys().test(0), "Regular button scanned at the priority rate!");
+
+    simClock.advance(95);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(clkMatrix.getFellKeys().test(0), "Regular button not detected by the regular scan!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    clkMatrix.setPriorityKeys(NULL);
+    simClock.advance(100);
+    clkMatrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(clkMatrix.getPressedKeys().any(), "Buttons not released!");
+    clkMatrix.setScanInterval(20);
+}
+
+
+/** @brief Test if a group scans its matrices in staggered time slots with a unified index */
+void test_matrix_group()
+//-----------------------------------------------------------------------------
+{
+    ButtonMatrix* matrices[] = { &clkMatrix, &compactMatrix };
+    ButtonMatrixGroup group(matrices, 2, simClock);
+    group.setScanInterval(20);
+    TEST_ASSERT_TRUE_MESSAGE(group.init(), "Group initialization failed!");
+    TEST_ASSERT_TRUE_MESSAGE(2 * ROWS * COLS == group.getNumButtons(), "Number of group buttons does not match!");
+
+    uint8_t matrixIdx = 0;
+    uint16_t btnIdx = 0;
+    TEST_ASSERT_TRUE_MESSAGE(group.toMatrixIndex(ROWS * COLS + 2, matrixIdx, btnIdx) && 1 == matrixIdx && 2 == btnIdx, "Group index not mapped!");
+    TEST_ASSERT_TRUE_MESSAGE(&clkButtons[1][1] == group.getButton(4), "Button of the first matrix not found!");
+
+    numBatchEvents = numBatchCalls = 0;
+    group.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls);
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    group.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents && 0 == batchEvents[0].idx, "First matrix not scanned in its slot!");
+    group.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents, "Second matrix scanned before its slot!");
+    TEST_ASSERT_TRUE_MESSAGE(10 == group.getTimeToNextUpdate(), "Slot of the second matrix not staggered!");
+
+    simClock.advance(10);
+    group.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numBatchEvents && ROWS * COLS == batchEvents[1].idx, "Second matrix not scanned in its slot!");
+
+    // a delayed update() just scans one matrix
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simClock.advance(25);
+    group.update();
+    TEST_ASSERT_TRUE_MESSAGE(3 == numBatchEvents, "Bus budget not respected!");
+    group.update();
+    TEST_ASSERT_TRUE_MESSAGE(4 == numBatchEvents && ROWS * COLS == batchEvents[3].idx, "Pending slot not scanned!");
+
+    group.registerButtonBatchCallback(NULL);
+    clkMatrix.setScanInterval(20);
+}
+
+
+/** @brief Test if the asynchronous scan advances on each update() without waiting for the transfers */
+void test_async_scan()
+//-----------------------------------------------------------------------------
+{
+    asyncMatrix.setScanInterval(20);
+    asyncMatrix.setDriveMode(DRIVE_PUSH_PULL);
+    asyncMatrix.init();
+    simClock.advance(20);
+
+    simIO.simButtonState(2, 2, BTN_STATE_PRESSED);
+    TEST_ASSERT_FALSE_MESSAGE(asyncMatrix.update(), "Scan completed without polling!");
+    TEST_ASSERT_TRUE_MESSAGE(asyncMatrix.isScanBusy(), "Asynchronous scan not in progress!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == asyncMatrix.getTimeToNextUpdate(), "Scan in progress not reported!");
+
+    // each line takes a read and a release transfer, each completing on the third poll
+    // (the first poll right after the start, so two updates per transfer)
+    uint8_t numUpdates = 1;
+    bool changed = false;
+    while (!changed && numUpdates < 100)
+    {
+        changed = asyncMatrix.update();
+        numUpdates++;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(changed, "Asynchronous scan did not complete!");
+    TEST_ASSERT_TRUE_MESSAGE(4 * COLS + 1 == numUpdates, "Number of updates per scan does not match!");
+    TEST_ASSERT_FALSE_MESSAGE(asyncMatrix.isScanBusy(), "Asynchronous scan still in progress!");
+    TEST_ASSERT_TRUE_MESSAGE(asyncMatrix.getButtonView(2, 2).isPressed(), "Button press not detected!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == asyncMatrix.getPressedKeys().count(), "Number of pressed buttons does not match!");
+
+    simIO.simButtonState(2, 2, BTN_STATE_RELEASED);
+}
+
+
+#if BTNMATRIX_EVENT_MICROS
+/** @brief Test if state changes are timestamped when their line has been sampled */
+void test_event_micros()
+//-----------------------------------------------------------------------------
+{
+    clkMatrix.setScanInterval(20);
+    simClock.advance(20);
+    clkMatrix.update();
+
+    simIO.simLineTime(&simClock, 100);
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(1, 2, BTN_STATE_PRESSED);
+    numBatchEvents = numBatchCalls = 0;
+    clkMatrix.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls);
+    simClock.advance(20);
+    const unsigned long start = simClock.micros();
+    clkMatrix.update();
+
+    TEST_ASSERT_TRUE_MESSAGE(2 == numBatchEvents, "Number of events does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == batchEvents[0].idx && start + 100 == batchEvents[0].micros, "First column not timestamped when sampled!");
+    TEST_ASSERT_TRUE_MESSAGE(5 == batchEvents[1].idx && start + 300 == batchEvents[1].micros, "Last column not timestamped when sampled!");
+    TEST_ASSERT_TRUE_MESSAGE(start + 300 == clkButtons[1][2].getStateChangeMicros(), "Button timestamp does not match!");
+
+    clkMatrix.registerButtonBatchCallback(NULL);
+    simIO.simLineTime(NULL, 0);
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(1, 2, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(simClock.micros() == clkButtons[1][2].getStateChangeMicros(), "Release not timestamped!");
+}
+
+
+/** Velocity events received */
+VelocityEvent velocityEvents[2];
+uint8_t numVelocityEvents = 0;
+
+/** @brief Velocity callback storing the events */
+void event_Velocity(void* ctx, const VelocityEvent& evt)
+//-----------------------------------------------------------------------------
+{
+    (void)ctx;
+    if (numVelocityEvents < 2)
+    {
+        velocityEvents[numVelocityEvents] = evt;
+    }
+    numVelocityEvents++;
+}
+
+
+/** @brief Test if the travel time between the contacts of a pair is measured */
+void test_velocity_pairs()
+//-----------------------------------------------------------------------------
+{
+    VelocityPair pairs[] = { {0, 1} };
+    clkMatrix.setVelocityPairs(pairs, 1);
+    clkMatrix.registerVelocityCallback(event_Velocity);
+    simIO.simLineTime(&simClock, 100);
+    numVelocityEvents = 0;
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == numVelocityEvents, "Velocity reported for the early contact!");
+    TEST_ASSERT_TRUE_MESSAGE(COLS * 100 == clkMatrix.getScanDuration(), "Scan duration does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(20000 == clkMatrix.getVelocityResolution(), "Resolution does not match the scan interval!");
+
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numVelocityEvents, "Velocity not reported!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == velocityEvents[0].idx && 20400 == velocityEvents[0].travelMicros, "Travel time does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(65 == velocityEvents[0].velocity, "Velocity does not match!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+
+    // both contacts closing between two scans -> travel time within the sampling of the lines
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numVelocityEvents, "Fast press not reported!");
+    TEST_ASSERT_TRUE_MESSAGE(100 == velocityEvents[1].travelMicros && 127 == velocityEvents[1].velocity, "Fast press does not match!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    simIO.simLineTime(NULL, 0);
+    clkMatrix.registerVelocityCallback(NULL);
+    clkMatrix.setVelocityPairs(NULL, 0);
+}
+#endif
+
+
+
+/** Last chord state reported and number of chord notifications */
+BTN_STATE chordState = BTN_STATE_UNINITIALIZED;
+uint8_t numChordCalls = 0;
+
+/** @brief Chord callback storing the reported state */
+void event_Chord(void* ctx, ButtonChord& chord, BTN_STATE state)
+//-----------------------------------------------------------------------------
+{
+    (void)ctx;
+    (void)chord;
+    chordState = state;
+    numChordCalls++;
+}
+
+
+/** @brief Test if chords are detected within their time window only */
+void test_chords()
+//-----------------------------------------------------------------------------
+{
+    static FixedKeySet<ROWS * COLS> keys;
+    keys.set(0);
+    keys.set(4);
+    ButtonChord chord(keys, event_Chord, 50);
+    clkMatrix.addChord(chord);
+    numChordCalls = 0;
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == numChordCalls, "Incomplete chord reported!");
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    simClock.advance(40);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numChordCalls && BTN_STATE_PRESSED == chordState && chord.isPressed(), "Chord not detected!");
+
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numChordCalls && BTN_STATE_RELEASED == chordState, "Chord release not reported!");
+
+    // the first button is still held, so the window has expired
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numChordCalls, "Chord detected outside its window!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+
+    // other buttons pressed -> rejected by an exclusive chord only
+    chord.setExclusive();
+    simIO.simButtonState(2, 2, BTN_STATE_PRESSED);
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numChordCalls, "Exclusive chord detected with another button pressed!");
+
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simIO.simButtonState(2, 2, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+
+    // a disabled button of a fed raw state does not reject an exclusive chord, a chord without callback is ignored
+    ButtonChord silent(keys, NULL);
+    clkMatrix.addChord(silent);
+    clkMatrix.setButtonEnabled(8, false);
+    FixedKeySet<ROWS * COLS> raw;
+    raw.set(0);
+    raw.set(4);
+    raw.set(8);
+    simClock.advance(20);
+    clkMatrix.processScan(raw, simClock.millis());
+    TEST_ASSERT_TRUE_MESSAGE(3 == numChordCalls && BTN_STATE_PRESSED == chordState, "Chord rejected by a disabled button!");
+
+    raw.clear();
+    simClock.advance(20);
+    clkMatrix.processScan(raw, simClock.millis());
+    clkMatrix.setButtonEnabled(8, true);
+    clkMatrix.removeChord(silent);
+    clkMatrix.removeChord(chord);
+}
+
+
+/** @brief Test if a held button is repeated at the deadlines */
+void test_auto_repeat()
+//-----------------------------------------------------------------------------
+{
+    static FixedKeySet<ROWS * COLS> keys;
+    keys.set(4);
+    clkMatrix.setScanInterval(1000);
+    clkMatrix.setAutoRepeat(&keys, 300, 100);
+    simClock.advance(1000);
+    clkMatrix.update();
+
+    numBatchEvents = numBatchCalls = 0;
+    clkMatrix.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls);
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    simClock.advance(1000);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(300 == clkMatrix.getTimeToNextUpdate(), "First repeat not scheduled!");
+
+    numBatchEvents = 0;
+    simClock.advance(300);
+    simIO.resetCounters();
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == simIO.getNumReads(), "Repeat caused a scan!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents && 4 == batchEvents[0].idx && BTN_ACTION_REPEAT == batchEvents[0].action,
+                             "Repeat not reported!");
+    TEST_ASSERT_TRUE_MESSAGE(BTN_EVENT_REPEAT == batchEvents[0].getKind(), "Event kind does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(100 == clkMatrix.getTimeToNextUpdate(), "Next repeat not scheduled at the rate!");
+
+    simClock.advance(100);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numBatchEvents && 4 == clkMatrix.getRepeatedKey(), "Second repeat not reported!");
+
+    // released before the long press -> neither a long press nor a click
+    numBatchEvents = 0;
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    simClock.advance(600);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents && BTN_ACTION_NONE == batchEvents[0].action, "Click reported after repeats!");
+    TEST_ASSERT_TRUE_MESSAGE(1000 == clkMatrix.getTimeToNextUpdate(), "Repeat still scheduled after release!");
+
+    clkMatrix.registerButtonBatchCallback(NULL);
+    clkMatrix.setAutoRepeat(NULL);
+    clkMatrix.setScanInterval(20);
+}
+
+
+/** @brief Key codes of two layers (layer 1 via button 8 held or button 7 toggled) */
+const keycode_t keyTable[2][ROWS * COLS] =
+{
+    { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, layerToggle(1), layerMomentary(1) },
+    { 0x1E, BTN_KEY_TRANSPARENT, 0x20, 0x21, 0x22, 0x23, 0x24, layerToggle(1), BTN_KEY_TRANSPARENT }
+};
+
+
+/** @brief Test if the events carry the key codes of the active layers */
+void test_keymap()
+//-----------------------------------------------------------------------------
+{
+    Keymap keymap(&keyTable[0][0], 2, ROWS * COLS);
+    clkMatrix.setKeymap(&keymap);
+    numBatchEvents = numBatchCalls = 0;
+    clkMatrix.registerButtonBatchCallback(event_Button_Batch, &numBatchCalls);
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(1 == numBatchEvents && 0x04 == batchEvents[0].keyCode, "Base layer key code does not match!");
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+
+    // momentary layer: transparent keys fall through, held keys keep their code
+    simIO.simButtonState(2, 2, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(keymap.isLayerActive(1), "Momentary layer not activated!");
+    numBatchEvents = 0;
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(2 == numBatchEvents && 0x1E == batchEvents[0].keyCode, "Layer key code does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(0x05 == batchEvents[1].keyCode, "Transparent key code does not match!");
+
+    simIO.simButtonState(2, 2, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(keymap.isLayerActive(1), "Momentary layer still active!");
+    numBatchEvents = 0;
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0x1E == batchEvents[0].keyCode, "Release does not carry the key code of the press!");
+
+    // toggle layer
+    simIO.simButtonState(2, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    simIO.simButtonState(2, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(keymap.isLayerActive(1), "Layer not toggled on!");
+    simIO.simButtonState(2, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    simIO.simButtonState(2, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(keymap.isLayerActive(1), "Layer not toggled off!");
+
+    clkMatrix.registerButtonBatchCallback(NULL);
+    clkMatrix.setKeymap(NULL);
+
+    // two keys holding the same momentary layer
+    keymap.press(8);
+    keymap.press(8);
+    keymap.release(8);
+    TEST_ASSERT_TRUE_MESSAGE(keymap.isLayerActive(1), "Momentary layer released while still held!");
+    keymap.release(8);
+    TEST_ASSERT_FALSE_MESSAGE(keymap.isLayerActive(1), "Momentary layer still active!");
+
+    // tables wider than the matrix keep their layer stride
+    static keycode_t wideTable[2][BTNMATRIX_MAX_BUTTONS + 4];
+    wideTable[1][5] = 0x1E;
+    Keymap wideKeymap(&wideTable[0][0], 2, BTNMATRIX_MAX_BUTTONS + 4);
+    TEST_ASSERT_TRUE_MESSAGE(0x1E == wideKeymap.lookup(1, 5), "Layer stride of a wide table does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(BTN_KEY_NONE == wideKeymap.press(BTNMATRIX_MAX_BUTTONS), "Key beyond the matrix resolved!");
+}
+
+
+/** @brief HID usages (button 7 is the left shift) */
+const keycode_t hidTable[ROWS * COLS] = { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0xE1, 0x0B };
+const keycode_t sharedTable[ROWS * COLS] = { 0x04, 0xE1, 0x06, 0x07, 0x08, 0x09, 0x0A, 0xE1, 0x04 };  /** Usages shared by two keys */
+
+
+/** @brief Sets the state of the first buttons and scans them */
+void simFirstButtons(uint8_t num, BTN_STATE state)
+//-----------------------------------------------------------------------------
+{
+    for (uint8_t idx = 0; idx < num; idx++)
+    {
+        simIO.simButtonState(idx / COLS, idx % COLS, state);
+    }
+    simClock.advance(20);
+    clkMatrix.update();
+}
+
+
+/** @brief Test if the boot and NKRO reports follow the pressed buttons */
+void test_hid_report()
+//-----------------------------------------------------------------------------
+{
+    Keymap keymap(hidTable, 1, ROWS * COLS);
+    clkMatrix.setKeymap(&keymap);
+    uint8_t bootReport[HIDReportBuilder::s_bootReportLength];
+    uint8_t nkroReport[3];
+    HIDReportBuilder boot(clkMatrix, bootReport, sizeof(bootReport));
+    HIDReportBuilder nkro(clkMatrix, nkroReport, sizeof(nkroReport), HID_NKRO);
+    boot.hasChanged();
+    nkro.hasChanged();
+
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(2, 1, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(boot.hasChanged() && nkro.hasChanged(), "Changed reports not indicated!");
+    TEST_ASSERT_TRUE_MESSAGE(0x02 == bootReport[0] && 0x04 == bootReport[2] && 0 == bootReport[3], "Boot report does not match!");
+    TEST_ASSERT_TRUE_MESSAGE(0x02 == nkroReport[0] && 0x10 == nkroReport[1] && 0 == nkroReport[2], "NKRO report does not match!");
+
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_FALSE_MESSAGE(boot.hasChanged(), "Unchanged report indicated!");
+
+    // seven keys -> rollover error in the boot report only
+    simFirstButtons(7, BTN_STATE_PRESSED);
+    TEST_ASSERT_TRUE_MESSAGE(0x01 == bootReport[2] && 0x01 == bootReport[7], "Rollover error not reported!");
+    TEST_ASSERT_TRUE_MESSAGE(0xF0 == nkroReport[1] && 0x07 == nkroReport[2], "NKRO report does not contain all keys!");
+
+    simIO.simButtonState(2, 0, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0x04 == bootReport[2] && 0x09 == bootReport[7], "Keys not restored after the rollover!");
+
+    // a key held beyond the six slots moves into the slot freed by another key
+    simFirstButtons(7, BTN_STATE_PRESSED);
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0x04 == bootReport[2] && 0x0A == bootReport[3] && 0x09 == bootReport[7], "Held key not moved into the free slot!");
+
+    simFirstButtons(ROWS * COLS, BTN_STATE_RELEASED);
+    TEST_ASSERT_TRUE_MESSAGE(0 == bootReport[0] && 0 == bootReport[2] && 0 == nkroReport[1], "Keys not released!");
+
+    // keys sharing a usage release it with the last of them
+    Keymap shared(sharedTable, 1, ROWS * COLS);
+    clkMatrix.setKeymap(&shared);
+    simIO.simButtonState(0, 0, BTN_STATE_PRESSED);
+    simIO.simButtonState(0, 1, BTN_STATE_PRESSED);
+    simIO.simButtonState(2, 1, BTN_STATE_PRESSED);
+    simIO.simButtonState(2, 2, BTN_STATE_PRESSED);
+    simClock.advance(20);
+    clkMatrix.update();
+    simIO.simButtonState(0, 0, BTN_STATE_RELEASED);
+    simIO.simButtonState(0, 1, BTN_STATE_RELEASED);
+    simClock.advance(20);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0x02 == bootReport[0] && 0x04 == bootReport[2] && 0 == bootReport[3], "Shared usage released in the boot report!");
+    TEST_ASSERT_TRUE_MESSAGE(0x02 == nkroReport[0] && 0x10 == nkroReport[1], "Shared usage released in the NKRO report!");
+
+    simFirstButtons(ROWS * COLS, BTN_STATE_RELEASED);
+    TEST_ASSERT_TRUE_MESSAGE(0 == bootReport[0] && 0 == bootReport[2] && 0 == nkroReport[0] && 0 == nkroReport[1],
+                             "Shared usages not released!");
+
+    clkMatrix.setKeymap(NULL);
+}
+
+#ifdef BTNMATRIX_HAS_COROUTINES
+/** @brief Minimal fire-and-forget coroutine type */
+struct TestTask
+{
+    struct promise_type
+    {
+        TestTask get_return_object() { return TestTask(); }
+        std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+        void return_void() {}
+        void unhandled_exception() {}
+    };
+};
+
+/** Events received by the coroutine */
+ButtonEvent coEvents[2];
+uint8_t numCoEvents = 0;
+
+/** @brief Coroutine awaiting a click of button 4 followed by any event */
+TestTask awaitClick(ButtonEventStream<4>& stream)
+//-----------------------------------------------------------------------------
+{
+    coEvents[numCoEvents++] = co_await stream.nextEvent(BTN_EVENT_CLICK, 4);
+    coEvents[numCoEvents++] = co_await stream.nextEvent();
+}
+
+
+/** @brief Test if coroutines are resumed by the events they are waiting for */
+void test_event_stream()
+//-----------------------------------------------------------------------------
+{
+    ButtonEventStream<4> stream(clkMatrix, BTN_EVENT_FELL | BTN_EVENT_CLICK);
+    numCoEvents = 0;
+    awaitClick(stream);
+    TEST_ASSERT_TRUE_MESSAGE(0 == numCoEvents, "Coroutine not suspended!");
+
+    simClock.advance(20);
+    simIO.simButtonState(1, 1, BTN_STATE_PRESSED);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == stream.resumePending(), "Coroutine resumed by a fell event!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == numCoEvents && 1 == stream.getNumQueued(), "Fell event not queued!");
+
+    // the coroutine is resumed after update() has returned
+    simClock.advance(20);
+    simIO.simButtonState(1, 1, BTN_STATE_RELEASED);
+    clkMatrix.update();
+    TEST_ASSERT_TRUE_MESSAGE(0 == numCoEvents, "Coroutine resumed from within update()!");
+    TEST_ASSERT_TRUE_MESSAGE(1 == stream.resumePending() && 0 < numCoEvents, "Coroutine not resumed by the click!");
+    TEST_ASSERT_TRUE_MESSAGE(4 == coEvents[0].idx && BTN_ACTION_CLICK == coEvents[0].action, "Click event does not match!");
+
+    // the queued fell event is taken right away without suspension
+    TEST_ASSERT_TRUE_MESSAGE(2 == numCoEvents && BTN_EVENT_FELL == coEvents[1].getKind(), "Queued event not taken!");
+    TEST_ASSERT_TRUE_MESSAGE(0 == stream.getNumQueued(), "Queue not empty!");
+}
+#endif
+
+
+/** @brief Subscription event handler */
+void event_Button_Subscription(void* ctx, const ButtonEvent& event)
+//-----------------------------------------------------------------------------
+{
+    event_Button_Batch(ctx, &event, 1);
+}
+
+
+/** @brief Batched button event handler */
+void event_Button_Batch(void* ctx, const ButtonEvent* events, uint8_t numEvents)
+//-----------------------------------------------------------------------------
+{
+    (*static_cast<uint8_t*>(ctx))++;
+    for (uint8_t evt = 0; evt < numEvents && numBatchEvents < ROWS * COLS; evt++)
+    {
+        batchEvents[numBatchEvents++] = events[evt];
+    }
+}
+
+
 /** @brief Button state changed event handler */
 void event_Button_State_changed(Button& button)
 //-----------------------------------------------------------------------------
@@ -434,7 +1740,15 @@ void event_Button_Action(Button& button)
 void setup()
 //-----------------------------------------------------------------------------
 {
+    matrix.setMemory(matrixMemory);
+    clkMatrix.setMemory(clkMemory);
+    replayMatrix.setMemory(replayMemory);
+    compactMatrix.setMemory(compactMemory);
+    asyncMatrix.setMemory(asyncMemory);
+    mcpMatrix.setMemory(mcpMemory);
     matrix.init();
+    clkMatrix.init();
+    compactMatrix.init();
     matrix.setScanInterval(0);
 
     delay(2000); // service delay
@@ -446,12 +1760,44 @@ void setup()
     RUN_TEST(test_parallel_button_press);
     RUN_TEST(test_button_long_press);
     RUN_TEST(test_skipped_rose_after_button_long_press);
+    RUN_TEST(test_manual_clock);
+    RUN_TEST(test_scan_trace_replay);
+    RUN_TEST(test_scan_trace_overflow);
+    RUN_TEST(test_compact_store);
+    RUN_TEST(test_large_matrix);
+    RUN_TEST(test_compact_store_aging);
     
+    RUN_TEST(test_changed_keys);
+
     // Eventing tests
     RUN_TEST(test_button_state_events);
     RUN_TEST(test_button_action_event_click);
     RUN_TEST(test_button_action_event_longpress);
     RUN_TEST(test_button_action_skipped_event_after_longpress);
+    RUN_TEST(test_button_batch_events);
+    RUN_TEST(test_button_subscriptions);
+    RUN_TEST(test_scan_mask);
+    RUN_TEST(test_scan_orientation);
+    RUN_TEST(test_drive_mode_push_pull);
+    RUN_TEST(test_drive_and_read);
+    RUN_TEST(test_mcp_drive_and_read);
+    RUN_TEST(test_settle_time_calibration);
+    RUN_TEST(test_reinit);
+    RUN_TEST(test_time_to_next_update);
+    RUN_TEST(test_priority_keys);
+    RUN_TEST(test_matrix_group);
+    RUN_TEST(test_async_scan);
+#if BTNMATRIX_EVENT_MICROS
+    RUN_TEST(test_event_micros);
+    RUN_TEST(test_velocity_pairs);
+#endif
+    RUN_TEST(test_chords);
+    RUN_TEST(test_auto_repeat);
+    RUN_TEST(test_keymap);
+    RUN_TEST(test_hid_report);
+#ifdef BTNMATRIX_HAS_COROUTINES
+    RUN_TEST(test_event_stream);
+#endif
 
     UNITY_END(); // stop unit testing
 }